@@ -0,0 +1,82 @@
+#ifndef cfg_h
+#define cfg_h
+
+/* the cfg and vertex layout shared by the files of the analysis. */
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include "dataflow.h"
+#include "pool.h"
+#include "set.h"
+
+#define LINESIZE	64
+#define NCLASS		10	/* pools of edge arrays */
+
+typedef struct vertex_t vertex_t;
+typedef struct sync_t sync_t;
+typedef struct stats_t stats_t;
+
+/* cfg_t: a control flow graph. */
+struct cfg_t {
+	size_t                  nvertex;        /* number of vertices           */
+	size_t                  nsymbol;        /* width of bitvectors          */
+	vertex_t*               vertex;         /* array of vertex              */
+	size_t                  max_succ;       /* most successors of a vertex  */
+	solver_t                solver;         /* used by liveness()           */
+	problem_t               problem;        /* last problem solved          */
+	bool                    solved;         /* liveness() has been run      */
+	set_t*                  lost;           /* symbols which may be dead    */
+	vertex_t**              edit;           /* edited since last solved     */
+	size_t                  nedit;          /* number of edited vertices    */
+	size_t                  maxedit;        /* size of edit array           */
+	size_t*                 rank;           /* postorder number, or NULL    */
+	sync_t*                 sync;           /* one cache line per vertex    */
+	char*                   sets;           /* IN and OUT, line aligned     */
+	char*                   usedef;         /* USE and DEF unless mapped    */
+	size_t                  setsize;        /* bytes of each IN and OUT     */
+	pages_t                 pages;          /* asked for sets and usedef    */
+	pages_t                 got;            /* smallest kind obtained       */
+	void*                   map;            /* mapped file with USE and DEF */
+	size_t                  mapsize;        /* size of map                  */
+	uint32_t*               preds;          /* predecessors of a mapped cfg */
+	size_t                  npreds;         /* entries in preds             */
+	pool_t**                edges;          /* edge arrays, per capacity    */
+	pool_t**                nodes;          /* worklist nodes, per thread   */
+	stats_t*                stats;          /* per thread, NULL if disabled */
+	_Atomic size_t*         visits;         /* times each vertex processed  */
+	solver_t                used;           /* solver of last solve         */
+	size_t                  rounds;         /* JACOBI rounds of last solve  */
+	double                  time;           /* seconds of last solve        */
+};
+
+/* vertex_t: a control flow graph vertex. the solvers only read it,
+ * and what they write lives in its sync_t and sets. the edges are
+ * arrays of vertex indices with room for a power of two entries, or of
+ * a loaded cfg point into its mapped file and preds with no more room
+ * until connect() copies them. */
+struct vertex_t {
+	set_t*                  set[NSETS];     /* IN, OUT, USE and DEF         */
+	uint32_t*               succ;           /* successor indices            */
+	uint32_t*               pred;           /* predecessor indices          */
+	sync_t*                 sync;           /* flags and locks              */
+	set_t*                  delta;          /* bits added to OUT, DELTA     */
+	uint32_t                nsucc;          /* number of successor vertices */
+	uint32_t                npred;          /* number of predecessors       */
+	uint32_t                index;          /* can be used for debugging    */
+	bool                    edited;         /* in cfg->edit                 */
+	bool                    shrunk;         /* IN or OUT may lose lost bits */
+};
+
+/* sync_t: the part of a vertex threads write concurrently. it has a
+ * cache line of its own, so a CAS on listed does not invalidate the
+ * lines holding other vertices' locks or any vertex_t. */
+struct sync_t {
+	_Alignas(LINESIZE) _Atomic bool listed; /* on worklist                  */
+	_Atomic unsigned        seq;            /* odd while IN/OUT is written  */
+	pthread_spinlock_t      listmutex;      /* held while vertex is processed */
+	pthread_spinlock_t      deltamutex;     /* delta mutex                  */
+};
+
+cfg_t*	alloc_cfg(size_t nvertex, size_t nsymbol, size_t max_succ, bool usedef);
+
+#endif
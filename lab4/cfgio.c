@@ -0,0 +1,378 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dataflow.h"
+#include "cfg.h"
+#include "error.h"
+#include "set.h"
+
+#define MAGIC		"LIVECFG3"
+#define BUFSIZE		(1 << 20)
+
+/* header_t: the start of a binary cfg file. it is followed by the
+ * nvertex + 1 offsets of each vertex's successors, the nedge successor
+ * indices padded to eight bytes, and then the USE and DEF sets of each
+ * vertex stored as set_t with their summaries, so they can be used
+ * where they are mapped. */
+typedef struct {
+	char		magic[8];
+	uint64_t	nvertex;
+	uint64_t	nsymbol;
+	uint64_t	max_succ;
+	uint64_t	nedge;
+} header_t;
+
+static void put(const void* p, size_t size, FILE* fp, const char* name)
+{
+	if (fwrite(p, 1, size, fp) != size)
+		syserror(errno, "cannot write \"%s\"", name);
+}
+
+void store_cfg(cfg_t* cfg, const char* name)
+{
+	FILE*		fp;
+	header_t	h;
+	vertex_t*	u;
+	uint64_t	offset;
+	uint32_t	index;
+	size_t		setsize;
+	size_t		i;
+	size_t		j;
+
+	fp = fopen(name, "wb");
+	if (fp == NULL)
+		syserror(errno, "cannot open \"%s\" for writing", name);
+
+	setvbuf(fp, NULL, _IOFBF, BUFSIZE);
+
+	memset(&h, 0, sizeof h);
+	memcpy(h.magic, MAGIC, sizeof h.magic);
+	h.nvertex = cfg->nvertex;
+	h.nsymbol = cfg->nsymbol;
+	h.max_succ = cfg->max_succ;
+
+	for (i = 0; i < cfg->nvertex; ++i)
+		h.nedge += cfg->vertex[i].nsucc;
+
+	put(&h, sizeof h, fp, name);
+
+	offset = 0;
+	for (i = 0; i <= cfg->nvertex; ++i) {
+		put(&offset, sizeof offset, fp, name);
+		if (i < cfg->nvertex)
+			offset += cfg->vertex[i].nsucc;
+	}
+
+	for (i = 0; i < cfg->nvertex; ++i) {
+		u = &cfg->vertex[i];
+		for (j = 0; j < u->nsucc; ++j) {
+			index = u->succ[j];
+			put(&index, sizeof index, fp, name);
+		}
+	}
+
+	index = 0;
+	if (h.nedge % 2 != 0)
+		put(&index, sizeof index, fp, name);
+
+	setsize = set_size(cfg->nsymbol);
+
+	for (i = 0; i < cfg->nvertex; ++i) {
+		put(cfg->vertex[i].set[USE], setsize, fp, name);
+		put(cfg->vertex[i].set[DEF], setsize, fp, name);
+	}
+
+	if (fclose(fp) != 0)
+		syserror(errno, "cannot write \"%s\"", name);
+}
+
+/* extent: a + b * c, or SIZE_MAX if that overflows. */
+static size_t extent(size_t a, size_t b, size_t c)
+{
+	size_t		r;
+
+	if (__builtin_mul_overflow(b, c, &r) || __builtin_add_overflow(a, r, &r))
+		return SIZE_MAX;
+
+	return r;
+}
+
+/* load_cfg: the successors and USE and DEF are used where they are
+ * mapped, and the predecessors are counted and then placed in one
+ * array. the mapping is private, so setbit() and connect() on a loaded
+ * cfg only change the process' copy of the page. the counts in the header are
+ * bounded before the size is computed from them, so a file cannot make
+ * it wrap around and the offsets then only index the file. */
+cfg_t* load_cfg(const char* name)
+{
+	int		fd;
+	struct stat	st;
+	char*		map;
+	header_t*	h;
+	uint64_t*	offset;
+	uint32_t*	succ;
+	char*		sets;
+	size_t		setsize;
+	size_t		size;
+	size_t		i;
+	uint64_t	k;
+	cfg_t*		cfg;
+	set_t*		s;
+	vertex_t*	u;
+	vertex_t*	v;
+
+	fd = open(name, O_RDONLY);
+	if (fd < 0)
+		syserror(errno, "cannot open \"%s\" for reading", name);
+
+	if (fstat(fd, &st) != 0)
+		syserror(errno, "cannot stat \"%s\"", name);
+
+	if ((size_t)st.st_size < sizeof(header_t))
+		error("\"%s\" is not a cfg file", name);
+
+	map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		syserror(errno, "cannot map \"%s\"", name);
+
+	close(fd);
+
+	h = (header_t*)map;
+	if (memcmp(h->magic, MAGIC, sizeof h->magic) != 0)
+		error("\"%s\" is not a cfg file", name);
+
+	if (h->nvertex > UINT32_MAX || h->max_succ > UINT32_MAX
+		|| h->nedge > h->nvertex * h->max_succ
+		|| h->nsymbol > 8 * (uint64_t)st.st_size)
+		error("\"%s\" has a bad header", name);
+
+	setsize = set_size(h->nsymbol);
+	size = extent(sizeof(header_t), h->nvertex + 1, sizeof(uint64_t));
+	size = extent(size, h->nedge + h->nedge % 2, sizeof(uint32_t));
+	size = extent(size, 2 * h->nvertex, setsize);
+
+	if (size != (size_t)st.st_size)
+		error("\"%s\" has size %zu but should have %zu", name, (size_t)st.st_size, size);
+
+	offset = (uint64_t*)(h + 1);
+	succ = (uint32_t*)(offset + h->nvertex + 1);
+	sets = (char*)(succ + h->nedge + h->nedge % 2);
+
+	if (offset[0] != 0 || offset[h->nvertex] != h->nedge)
+		error("\"%s\" has bad successor offsets", name);
+
+	cfg = alloc_cfg(h->nvertex, h->nsymbol, h->max_succ, false);
+	cfg->map = map;
+	cfg->mapsize = st.st_size;
+
+	cfg->preds = malloc(h->nedge * sizeof cfg->preds[0]);
+	cfg->npreds = h->nedge;
+	if (h->nedge > 0 && cfg->preds == NULL)
+		error("out of memory");
+
+	for (i = 0; i < h->nvertex; ++i) {
+		if (offset[i+1] < offset[i] || offset[i+1] - offset[i] > h->max_succ
+			|| offset[i+1] > h->nedge)
+			error("\"%s\" has bad successors for vertex %zu", name, i);
+
+		u = &cfg->vertex[i];
+		u->nsucc = offset[i+1] - offset[i];
+		u->succ = u->nsucc > 0 ? &succ[offset[i]] : NULL;
+
+		for (k = offset[i]; k < offset[i+1]; ++k) {
+			if (succ[k] >= h->nvertex || cfg->vertex[succ[k]].npred == UINT32_MAX)
+				error("\"%s\" has bad successors for vertex %zu", name, i);
+			cfg->vertex[succ[k]].npred += 1;
+		}
+	}
+
+	/* each pred array is filled from its end, backwards, so the
+	 * predecessors come in the order connect() would add them. */
+	for (i = 0, k = 0; i < h->nvertex; ++i) {
+		u = &cfg->vertex[i];
+		k += u->npred;
+		u->pred = u->npred > 0 ? &cfg->preds[k] : NULL;
+	}
+
+	for (i = h->nvertex; i-- > 0; ) {
+		u = &cfg->vertex[i];
+		for (k = u->nsucc; k-- > 0; ) {
+			v = &cfg->vertex[u->succ[k]];
+			v->pred -= 1;
+			*v->pred = i;
+		}
+	}
+
+	for (i = 0; i < h->nvertex; ++i) {
+		s = (set_t*)(sets + 2 * i * setsize);
+		cfg->vertex[i].set[USE] = s;
+		cfg->vertex[i].set[DEF] = (set_t*)((char*)s + setsize);
+
+		if (!valid_set(s, h->nsymbol)
+			|| !valid_set(cfg->vertex[i].set[DEF], h->nsymbol))
+			error("\"%s\" has bad sets for vertex %zu", name, i);
+	}
+
+	return cfg;
+}
+
+cfg_t* import_cfg(const char* name, size_t nsymbol)
+{
+	FILE*		fp;
+	char		line[64];
+	uint64_t	pred;
+	uint64_t	succ;
+	uint32_t*	edge;
+	size_t*		nsucc;
+	size_t		nedge;
+	size_t		maxedge;
+	size_t		nvertex;
+	size_t		max_succ;
+	size_t		lineno;
+	size_t		i;
+	int		n;
+	cfg_t*		cfg;
+
+	fp = fopen(name, "r");
+	if (fp == NULL)
+		syserror(errno, "cannot open \"%s\" for reading", name);
+
+	edge = NULL;
+	nedge = maxedge = nvertex = lineno = 0;
+
+	while (fgets(line, sizeof line, fp) != NULL) {
+		lineno += 1;
+		n = sscanf(line, "%" SCNu64 " %" SCNu64, &pred, &succ);
+		if (n == EOF)
+			continue;
+
+		if (n != 2 || pred >= UINT32_MAX || succ >= UINT32_MAX)
+			error("\"%s\" has a bad edge on line %zu", name, lineno);
+
+		if (nedge == maxedge) {
+			maxedge = maxedge == 0 ? 1024 : 2 * maxedge;
+			edge = realloc(edge, 2 * maxedge * sizeof edge[0]);
+			if (edge == NULL)
+				error("out of memory");
+		}
+
+		edge[2 * nedge] = pred;
+		edge[2 * nedge + 1] = succ;
+		nedge += 1;
+
+		if (pred >= nvertex)
+			nvertex = pred + 1;
+		if (succ >= nvertex)
+			nvertex = succ + 1;
+	}
+
+	if (ferror(fp))
+		syserror(errno, "cannot read \"%s\"", name);
+
+	fclose(fp);
+
+	if (nvertex == 0)
+		error("\"%s\" has no edges", name);
+
+	nsucc = calloc(nvertex, sizeof nsucc[0]);
+	if (nsucc == NULL)
+		error("out of memory");
+
+	max_succ = 0;
+	for (i = 0; i < nedge; ++i)
+		if (++nsucc[edge[2 * i]] > max_succ)
+			max_succ = nsucc[edge[2 * i]];
+
+	cfg = new_cfg(nvertex, nsymbol, max_succ);
+
+	for (i = 0; i < nedge; ++i)
+		connect(cfg, edge[2 * i], edge[2 * i + 1]);
+
+	free(nsucc);
+	free(edge);
+
+	return cfg;
+}
+
+size_t nvertices(cfg_t* cfg)
+{
+	return cfg->nvertex;
+}
+
+/* export_cfg: the text formats are built in a large buffer which is
+ * written whenever it cannot hold another vertex. */
+void export_cfg(cfg_t* cfg, const char* name, format_t format)
+{
+	FILE*		fp;
+	vertex_t*	u;
+	char*		buf;
+	char*		p;
+	size_t		size;
+	size_t		i;
+	size_t		j;
+
+	if (format == BINARY) {
+		store_cfg(cfg, name);
+		return;
+	}
+
+	fp = fopen(name, "w");
+	if (fp == NULL)
+		syserror(errno, "cannot open \"%s\" for writing", name);
+
+	/* a vertex needs at most two numbers per successor and 8 more. */
+	size = BUFSIZE + 44 * (cfg->max_succ + 1);
+	buf = malloc(size);
+	if (buf == NULL)
+		error("out of memory");
+
+	p = buf;
+
+	if (format == DOT)
+		p += sprintf(p, "digraph cfg {\n");
+
+	for (i = 0; i < cfg->nvertex; ++i) {
+		u = &cfg->vertex[i];
+
+		if (format == DOT && u->nsucc > 0) {
+			p = utoa(p, i);
+			memcpy(p, " -> {", 5);
+			p += 5;
+			for (j = 0; j < u->nsucc; ++j) {
+				*p++ = ' ';
+				p = utoa(p, u->succ[j]);
+			}
+			memcpy(p, " }\n", 3);
+			p += 3;
+		} else if (format == EDGES) {
+			for (j = 0; j < u->nsucc; ++j) {
+				p = utoa(p, i);
+				*p++ = ' ';
+				p = utoa(p, u->succ[j]);
+				*p++ = '\n';
+			}
+		}
+
+		if (p - buf >= BUFSIZE) {
+			put(buf, p - buf, fp, name);
+			p = buf;
+		}
+	}
+
+	if (format == DOT)
+		p += sprintf(p, "}\n");
+
+	put(buf, p - buf, fp, name);
+	free(buf);
+
+	if (fclose(fp) != 0)
+		syserror(errno, "cannot write \"%s\"", name);
+}
@@ -1,24 +1,124 @@
+#include <errno.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdatomic.h>
 #include <inttypes.h>
 #include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
 #include "dataflow.h"
+#include "cfg.h"
 #include "error.h"
-#include "list.h"
+#include "pages.h"
+#include "pool.h"
 #include "set.h"
+#include "team.h"
 
+#ifndef NTHREADS
 #define NTHREADS 4
+#endif
+#define SAMPLE		256	/* vertices processed between samples */
+#define NBUCKET		4096	/* priorities of the worklist */
+#define MINEDGES	2	/* entries of the smallest edge array */
 
-typedef struct vertex_t vertex_t;
 typedef struct task_t   task_t;
+typedef struct scc_t    scc_t;
+typedef struct partition_t partition_t;
+typedef struct message_t message_t;
+typedef struct jacobi_t jacobi_t;
 typedef struct queue_t queue_t;
 typedef struct queue_node_t queue_node_t;
 
+/* sample_t: the work a thread saw pending at some time. */
+typedef struct {
+	double                  time;           /* seconds into the solve       */
+	size_t                  length;         /* vertices or components       */
+} sample_t;
+
+/* stats_t: what one worker did during the last solve. */
+struct stats_t {
+	size_t                  processed;      /* vertices processed           */
+	size_t                  changed;        /* of which the result changed  */
+	size_t                  casfail;        /* preds or succs already listed*/
+	size_t                  contended;      /* spinlocks found held         */
+	double                  wait;           /* seconds spent waiting on them*/
+	double                  begin;          /* start of the solve           */
+	size_t                  next;           /* processed at next sample     */
+	sample_t*               sample;         /* pending work over time       */
+	size_t                  nsample;        /* number of samples            */
+	size_t                  maxsample;      /* size of sample array         */
+};
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/* lock: without stats this is pthread_spin_lock. with stats, only a
+ * lock which is already held is timed, so an uncontended lock costs
+ * one extra trylock. */
+static void lock(pthread_spinlock_t* mutex, stats_t* stats)
+{
+	double          begin;
+
+	if (stats == NULL) {
+		pthread_spin_lock(mutex);
+		return;
+	}
+
+	if (pthread_spin_trylock(mutex) == 0)
+		return;
+
+	begin = now();
+	pthread_spin_lock(mutex);
+	stats->contended += 1;
+	stats->wait += now() - begin;
+}
+
+static void sample(stats_t* stats, size_t length)
+{
+	if (stats->nsample == stats->maxsample) {
+		stats->maxsample = stats->maxsample == 0 ? 64 : 2 * stats->maxsample;
+		stats->sample = realloc(stats->sample, stats->maxsample * sizeof stats->sample[0]);
+		if (stats->sample == NULL)
+			error("out of memory");
+	}
+
+	stats->sample[stats->nsample].time = now() - stats->begin;
+	stats->sample[stats->nsample].length = length;
+	stats->nsample += 1;
+	stats->next = stats->processed + SAMPLE;
+}
+
+/* due: SAMPLE more vertices have been processed since the last sample. */
+static bool due(stats_t* stats)
+{
+	return stats != NULL && stats->processed >= stats->next;
+}
+
+/* queue_t: the worklist, a stack per bucket of vertices with nearby
+ * ranks, where q_remove takes from the lowest non-empty bucket. the
+ * rank of a vertex is its postorder number, reversed for a forward
+ * problem, so successors tend to be processed before predecessors in a
+ * backward problem and the other way round in a forward one. full has
+ * a bit per non-empty bucket and summary a bit per non-zero word of
+ * full. without ranks every vertex is in bucket 0. */
 struct queue_t {
-	queue_node_t *first;
+	queue_node_t *bucket[NBUCKET];
+	uint64_t full[NBUCKET / 64];
+	uint64_t summary;
+	size_t *rank;
+	size_t nvertex;
+	bool reverse;
+	size_t length;
 	pthread_spinlock_t remove_lock;
 };
 
@@ -41,58 +141,200 @@ void q_free(queue_t *q)
 	free(q);
 }
 
-void q_insert(queue_t *q, vertex_t *v)
+/* q_order: rank the vertices of the empty q by the postorder number of
+ * each of the nvertex vertices. */
+void q_order(queue_t *q, size_t *rank, size_t nvertex, bool reverse)
 {
-	pthread_spin_lock(&q->remove_lock);
-	queue_node_t *n = malloc(sizeof(*n));
-	n->succ = q->first;
+	q->rank = rank;
+	q->nvertex = nvertex;
+	q->reverse = reverse;
+}
+
+static size_t q_bucket(queue_t *q, vertex_t *v)
+{
+	size_t r;
+
+	if (q->rank == NULL)
+		return 0;
+
+	r = q->rank[v->index];
+	if (q->reverse)
+		r = q->nvertex - 1 - r;
+
+	return r * NBUCKET / q->nvertex;
+}
+
+/* q_insert and q_remove: the nodes come from and go back to the pool
+ * of the calling thread. */
+void q_insert(queue_t *q, vertex_t *v, pool_t *pool, stats_t *stats)
+{
+	queue_node_t *n = pool_alloc(pool);
+	size_t b = q_bucket(q, v);
+	lock(&q->remove_lock, stats);
+	n->succ = q->bucket[b];
 	n->data = v;
-	q->first = n;
+	q->bucket[b] = n;
+	q->full[b / 64] |= 1ULL << (b % 64);
+	q->summary |= 1ULL << (b / 64);
+	q->length += 1;
 	pthread_spin_unlock(&q->remove_lock);
 }
 
-vertex_t *q_remove(queue_t *q)
+vertex_t *q_remove(queue_t *q, pool_t *pool, stats_t *stats)
 {
-	pthread_spin_lock(&q->remove_lock);
-	if (!q->first) {
+	size_t j;
+	size_t b;
+
+	lock(&q->remove_lock, stats);
+	if (!q->summary) {
 		pthread_spin_unlock(&q->remove_lock);
 		return NULL;
 	}
-	queue_node_t *n = q->first;
+	j = __builtin_ctzll(q->summary);
+	b = 64 * j + __builtin_ctzll(q->full[j]);
+	queue_node_t *n = q->bucket[b];
 	vertex_t *v = n->data;
-	q->first = q->first->succ;
-	free(n);
+	q->bucket[b] = n->succ;
+	if (!q->bucket[b]) {
+		q->full[j] &= ~(1ULL << (b % 64));
+		if (!q->full[j])
+			q->summary &= ~(1ULL << j);
+	}
+	q->length -= 1;
 	pthread_spin_unlock(&q->remove_lock);
+	pool_free(pool, n);
 	return v;
 }
 
-/* cfg_t: a control flow graph. */
-struct cfg_t {
-	size_t                  nvertex;        /* number of vertices           */
-	size_t                  nsymbol;        /* width of bitvectors          */
-	vertex_t*               vertex;         /* array of vertex              */
+size_t q_length(queue_t *q)
+{
+	size_t length;
+
+	pthread_spin_lock(&q->remove_lock);
+	length = q->length;
+	pthread_spin_unlock(&q->remove_lock);
+	return length;
+}
+
+/* task_t: what each worker thread needs. */
+struct task_t {
+	cfg_t*                  cfg;            /* graph being analysed         */
+	queue_t*                worklist;       /* shared by all workers        */
+	set_t*                  scratch;        /* empty set owned by worker    */
+	scc_t*                  scc;            /* components, for SCC          */
+	vertex_t**              stack;          /* local worklist               */
+	size_t                  nstack;         /* vertices on local worklist   */
+	partition_t*            part;           /* regions, for PARTITION       */
+	size_t                  id;             /* region owned, for PARTITION  */
+	jacobi_t*               jacobi;         /* rounds, for JACOBI           */
+	stats_t*                stats;          /* NULL unless enabled          */
+	pool_t*                 nodes;          /* worklist nodes of worker     */
+	bool*                   listed;         /* own listed flags, for SLICED */
+	size_t                  begin;          /* first slice, for SLICED      */
+	size_t                  end;            /* after last slice, for SLICED */
+};
+
+/* scc_t: the strongly connected components of a cfg, in the reverse
+ * topological order Tarjan's algorithm finds them in. */
+struct scc_t {
+	size_t                  ncomp;          /* number of components         */
+	size_t                  maxcomp;        /* largest component            */
+	size_t*                 comp;           /* component of each vertex     */
+	size_t*                 first;          /* first member of component    */
+	vertex_t**              member;         /* vertices by component        */
+	_Atomic size_t*         waiting;        /* edges to unsolved components */
+	size_t*                 ready;          /* stack of solvable components */
+	size_t                  nready;         /* number of ready components   */
+	_Atomic size_t          remaining;      /* components not yet solved    */
+	pthread_spinlock_t      readymutex;     /* ready mutex                  */
+};
+
+static const problem_t live = { BACKWARD, UNION };
+
+static pages_t pages = BASE;    /* for the next alloc_cfg       */
+
+static const char* solver_name[NSOLVERS] = {
+	[WORKLIST]      = "worklist",
+	[DELTA]         = "delta",
+	[SCC]           = "scc",
+	[PARTITION]     = "partition",
+	[JACOBI]        = "jacobi",
+	[SLICED]        = "sliced",
+	[MONOTONE]      = "monotone",
+	[SEQUENTIAL]    = "sequential",
+	[AUTO]          = "auto",
+};
+
+/* visit: count that u was processed and whether its result changed. */
+static void visit(task_t* task, vertex_t* u, bool changed)
+{
+	if (task->stats == NULL)
+		return;
+
+	task->stats->processed += 1;
+	task->stats->changed += changed;
+	atomic_fetch_add_explicit(&task->cfg->visits[u->index], 1, memory_order_relaxed);
+}
+
+/* message_t: bits added to the IN of a successor owned by another
+ * region, to be added to the pending delta of vertex to. a received
+ * message is emptied and kept by the receiver for its own sends. */
+struct message_t {
+	message_t*              next;           /* next in mailbox              */
+	vertex_t*               to;             /* predecessor of the sender    */
+	set_t*                  bits;           /* added to IN of the sender    */
+};
+
+/* partition_t: one region of the cfg per thread. */
+struct partition_t {
+	size_t*                 part;           /* region of each vertex        */
+	size_t                  size[NTHREADS]; /* vertices in each region      */
+	_Atomic(message_t*)     mailbox[NTHREADS]; /* received messages         */
+	pthread_spinlock_t      mailmutex[NTHREADS]; /* mailbox mutex           */
+	message_t*              spare[NTHREADS]; /* empty messages to send    */
+	_Atomic size_t          busy;           /* active threads and messages  */
 };
 
-/* vertex_t: a control flow graph vertex. */
-struct vertex_t {
-	size_t                  index;          /* can be used for debugging    */
-	set_t*                  set[NSETS];     /* live in from this vertex     */
-	set_t*                  prev;           /* alternating with set[IN]     */
-	size_t                  nsucc;          /* number of successor vertices */
-	vertex_t**              succ;           /* successor vertices           */
-	list_t*                 pred;           /* predecessor vertices         */
-	_Atomic bool            listed;         /* on worklist                  */
-	pthread_spinlock_t listmutex; /* set mutex */
-	pthread_spinlock_t inmutex; /* set mutex */
+/* jacobi_t: the rounds of the JACOBI solver. each round first
+ * recomputes OUT of the dirty vertices from the IN sets of the previous
+ * round, and only then writes the new IN sets, so OUT is the second
+ * buffer and the result does not depend on the thread count. */
+struct jacobi_t {
+	size_t*                 order;          /* successors before preds      */
+	size_t                  nword;          /* words in each dirty bitmap   */
+	uint64_t*               dirty[2];       /* this and next round          */
+	_Atomic size_t          changed[2];     /* IN sets changed in round     */
+	pthread_barrier_t       barrier;        /* between the phases           */
 };
 
-static void clean_vertex(vertex_t* v);
-static void init_vertex(vertex_t* v, size_t index, size_t nsymbol, size_t max_succ);
+static bool uses_delta(cfg_t* cfg);
+static void clean_vertex(cfg_t* cfg, vertex_t* v);
+static void free_edges(cfg_t* cfg, uint32_t* a, size_t n);
+static void init_vertex(cfg_t* cfg, size_t index, bool usedef);
 
 cfg_t* new_cfg(size_t nvertex, size_t nsymbol, size_t max_succ)
+{
+	return alloc_cfg(nvertex, nsymbol, max_succ, true);
+}
+
+/* skew: where a set of IN and OUT starts in its first cache line. sets
+ * of more than one slice start just before the end of the line, so
+ * their words start on the next line and so do the words of each
+ * slice, which the sliced solver writes from different threads. */
+static size_t skew(size_t nsymbol)
+{
+	return nsymbol > SLICE ? LINESIZE - sizeof(set_t) : 0;
+}
+
+/* alloc_cfg: without usedef the caller provides the USE and DEF sets. */
+cfg_t* alloc_cfg(size_t nvertex, size_t nsymbol, size_t max_succ, bool usedef)
 {
 	size_t          i;
 	cfg_t*          cfg;
+	pages_t         got;
+
+	if (nvertex > UINT32_MAX)
+		error("%zu vertices do not fit 32-bit indices", nvertex);
 
 	cfg = calloc(1, sizeof(cfg_t));
 	if (cfg == NULL)
@@ -100,60 +342,263 @@ cfg_t* new_cfg(size_t nvertex, size_t nsymbol, size_t max_succ)
 
 	cfg->nvertex = nvertex;
 	cfg->nsymbol = nsymbol;
+	cfg->max_succ = max_succ;
 
+	/* the sets a vertex writes start on a cache line of their own,
+	 * while USE and DEF are only read and packed like in a file. */
+	cfg->setsize = (skew(nsymbol) + set_size(nsymbol) + LINESIZE - 1) / LINESIZE * LINESIZE;
 	cfg->vertex = calloc(nvertex, sizeof(vertex_t));
-	if (cfg->vertex == NULL)
+	cfg->sync = aligned_alloc(LINESIZE, nvertex * sizeof(sync_t));
+
+	/* the sets are most of the memory, so they get the large pages. */
+	cfg->pages = pages;
+	cfg->sets = alloc_pages(2 * nvertex * cfg->setsize, pages, &cfg->got);
+
+	if (usedef) {
+		cfg->usedef = alloc_pages(2 * nvertex * set_size(nsymbol), pages, &got);
+		if (got < cfg->got)
+			cfg->got = got;
+	}
+
+	if (nvertex > 0 && (cfg->vertex == NULL
+		|| cfg->sync == NULL || cfg->sets == NULL
+		|| (usedef && cfg->usedef == NULL)))
 		error("out of memory");
 
 	for (i = 0; i < nvertex; i += 1)
-		init_vertex(&cfg->vertex[i], i, nsymbol, max_succ);
+		init_vertex(cfg, i, usedef);
+
+	set_solver(cfg, AUTO);
+
+	cfg->edges = calloc(NCLASS, sizeof cfg->edges[0]);
+	if (cfg->edges == NULL)
+		error("out of memory");
+
+	for (i = 0; i < NCLASS; i += 1)
+		cfg->edges[i] = new_pool((MINEDGES << i) * sizeof(uint32_t));
+
+	/* one pool of worklist nodes per worker and one for the caller. */
+	cfg->nodes = calloc(NTHREADS + 1, sizeof cfg->nodes[0]);
+	if (cfg->nodes == NULL)
+		error("out of memory");
+
+	for (i = 0; i <= NTHREADS; i += 1)
+		cfg->nodes[i] = new_pool(sizeof(queue_node_t));
 
 	return cfg;
 }
 
-static void clean_vertex(vertex_t* v)
+static void clean_vertex(cfg_t* cfg, vertex_t* v)
 {
-	int             i;
-
-	for (i = 0; i < NSETS; i += 1)
-		free_set(v->set[i]);
-	free_set(v->prev);
-	free(v->succ);
-	free_list(&v->pred);
+	free_edges(cfg, v->succ, v->nsucc);
+	free_edges(cfg, v->pred, v->npred);
+	free_set(v->delta);
 }
 
-static void init_vertex(vertex_t* v, size_t index, size_t nsymbol, size_t max_succ)
+static void init_vertex(cfg_t* cfg, size_t index, bool usedef)
 {
-	int             i;
+	vertex_t*       v = &cfg->vertex[index];
+	size_t          size = set_size(cfg->nsymbol);
 
 	v->index        = index;
-	v->succ         = calloc(max_succ, sizeof(vertex_t*));
+	v->sync         = &cfg->sync[index];
+	v->set[IN]      = place_set(cfg->sets + 2 * index * cfg->setsize + skew(cfg->nsymbol), cfg->nsymbol);
+	v->set[OUT]     = place_set(cfg->sets + (2 * index + 1) * cfg->setsize + skew(cfg->nsymbol), cfg->nsymbol);
 
-	if (v->succ == NULL)
-		error("out of memory");
+	if (usedef) {
+		v->set[USE] = place_set(cfg->usedef + 2 * index * size, cfg->nsymbol);
+		v->set[DEF] = place_set(cfg->usedef + (2 * index + 1) * size, cfg->nsymbol);
+	}
 
-	for (i = 0; i < NSETS; i += 1)
-		v->set[i] = new_set(nsymbol);
+	memset(v->sync, 0, sizeof(sync_t));
 
-	v->prev = new_set(nsymbol);
-	int err = pthread_spin_init(&v->inmutex, PTHREAD_PROCESS_PRIVATE);
+	int err = pthread_spin_init(&v->sync->listmutex, PTHREAD_PROCESS_PRIVATE);
 	if (err)
 		error("Failed to init mutex");
-	err = pthread_spin_init(&v->listmutex, PTHREAD_PROCESS_PRIVATE);
+	err = pthread_spin_init(&v->sync->deltamutex, PTHREAD_PROCESS_PRIVATE);
 	if (err)
 		error("Failed to init mutex");
 }
 
+/* uses_delta: the solver keeps a pending delta in every vertex. */
+static bool uses_delta(cfg_t* cfg)
+{
+	return cfg->solver == DELTA || cfg->solver == PARTITION;
+}
+
+void set_pages(pages_t p)
+{
+	pages = p;
+}
+
+pages_t got_pages(cfg_t* cfg)
+{
+	return cfg->got;
+}
+
+void set_solver(cfg_t* cfg, solver_t solver)
+{
+	if (solver == AUTO)
+		solver = (cfg->nsymbol + SLICE - 1) / SLICE >= NTHREADS ? SLICED : WORKLIST;
+
+	cfg->solver = solver;
+}
+
+solver_t find_solver(const char* name)
+{
+	solver_t        s;
+
+	for (s = 0; s < NSOLVERS; s += 1)
+		if (strcmp(name, solver_name[s]) == 0)
+			break;
+
+	return s;
+}
+
 void free_cfg(cfg_t* cfg)
 {
 	size_t          i;
 
 	for (i = 0; i < cfg->nvertex; i += 1)
-		clean_vertex(&cfg->vertex[i]);
+		clean_vertex(cfg, &cfg->vertex[i]);
+
+	if (cfg->map != NULL && munmap(cfg->map, cfg->mapsize) != 0)
+		syserror(errno, "munmap failed");
+
+	free(cfg->preds);
+
+	/* the pooled edge arrays and worklist nodes are freed in bulk. */
+	for (i = 0; i < NCLASS; i += 1)
+		free_pool(cfg->edges[i]);
+	for (i = 0; i <= NTHREADS; i += 1)
+		free_pool(cfg->nodes[i]);
+
+	free(cfg->edges);
+	free(cfg->nodes);
+	free_pages(cfg->sets, 2 * cfg->nvertex * cfg->setsize, cfg->pages);
+	free_pages(cfg->usedef, 2 * cfg->nvertex * set_size(cfg->nsymbol), cfg->pages);
+	free(cfg->sync);
 	free(cfg->vertex);
+	free_set(cfg->lost);
+	free(cfg->edit);
+	free(cfg->rank);
+	set_stats(cfg, false);
 	free(cfg);
 }
 
+/* edited: remember that v must be processed again by liveness(). */
+static void edited(cfg_t* cfg, vertex_t* v)
+{
+	if (!cfg->solved || v->edited)
+		return;
+
+	if (cfg->nedit == cfg->maxedit) {
+		cfg->maxedit = cfg->maxedit == 0 ? 64 : 2 * cfg->maxedit;
+		cfg->edit = realloc(cfg->edit, cfg->maxedit * sizeof cfg->edit[0]);
+		if (cfg->edit == NULL)
+			error("out of memory");
+	}
+
+	v->edited = true;
+	cfg->edit[cfg->nedit++] = v;
+}
+
+/* shrunk: v may lose the symbols the caller adds to cfg->lost, and
+ * they must then also be removed from every vertex they reached. */
+static bool shrunk(cfg_t* cfg, vertex_t* v)
+{
+	if (!cfg->solved)
+		return false;
+
+	if (cfg->lost == NULL)
+		cfg->lost = new_set(cfg->nsymbol);
+
+	edited(cfg, v);
+	v->shrunk = true;
+
+	return true;
+}
+
+/* capacity: the room of an edge array of n entries, the smallest power
+ * of two from MINEDGES up, so arrays of the same capacity share a pool
+ * and the room is found from n alone. */
+static size_t capacity(size_t n)
+{
+	size_t          c;
+
+	if (n == 0)
+		return 0;
+
+	for (c = MINEDGES; c < n; c *= 2)
+		;
+
+	return c;
+}
+
+/* edge_class: the pool of an edge array of capacity c, or NCLASS for
+ * an array too large for the pools, which is from malloc. */
+static size_t edge_class(size_t c)
+{
+	size_t          k;
+
+	for (k = 0; k < NCLASS && (size_t)MINEDGES << k < c; ++k)
+		;
+
+	return k;
+}
+
+/* borrowed: a is the edges of a loaded cfg, in its map or preds. */
+static bool borrowed(cfg_t* cfg, uint32_t* a)
+{
+	char*           p = (char*)a;
+
+	return (cfg->map != NULL && p >= (char*)cfg->map && p < (char*)cfg->map + cfg->mapsize)
+		|| (a >= cfg->preds && a < cfg->preds + cfg->npreds);
+}
+
+static void free_edges(cfg_t* cfg, uint32_t* a, size_t n)
+{
+	size_t          k;
+
+	if (n == 0 || borrowed(cfg, a))
+		return;
+
+	k = edge_class(capacity(n));
+	if (k == NCLASS)
+		free(a);
+	else
+		pool_free(cfg->edges[k], a);
+}
+
+/* resize: an edge array for m entries with the first of the n entries
+ * of a, which is a itself when the capacity is the same. a borrowed
+ * array has room for its n entries only. */
+static uint32_t* resize(cfg_t* cfg, uint32_t* a, size_t n, size_t m)
+{
+	uint32_t*       b;
+	size_t          k;
+
+	if (borrowed(cfg, a) ? m <= n : capacity(n) == capacity(m))
+		return a;
+
+	b = NULL;
+	if (m > 0) {
+		k = edge_class(capacity(m));
+		if (k == NCLASS)
+			b = malloc(capacity(m) * sizeof b[0]);
+		else
+			b = pool_alloc(cfg->edges[k]);
+		if (b == NULL)
+			error("out of memory");
+		if (n > 0)
+			memcpy(b, a, (n < m ? n : m) * sizeof b[0]);
+	}
+
+	free_edges(cfg, a, n);
+
+	return b;
+}
+
 void connect(cfg_t* cfg, size_t pred, size_t succ)
 {
 	vertex_t*       u;
@@ -162,8 +607,45 @@ void connect(cfg_t* cfg, size_t pred, size_t succ)
 	u = &cfg->vertex[pred];
 	v = &cfg->vertex[succ];
 
-	u->succ[u->nsucc++ ] = v;
-	insert_last(&v->pred, u);
+	if (u->nsucc == cfg->max_succ)
+		error("vertex %zu already has %zu successors", pred, cfg->max_succ);
+
+	u->succ = resize(cfg, u->succ, u->nsucc, u->nsucc + 1);
+	u->succ[u->nsucc++] = succ;
+	v->pred = resize(cfg, v->pred, v->npred, v->npred + 1);
+	v->pred[v->npred++] = pred;
+	edited(cfg, u);
+}
+
+void disconnect(cfg_t* cfg, size_t pred, size_t succ)
+{
+	vertex_t*       u;
+	vertex_t*       v;
+	size_t          j;
+
+	u = &cfg->vertex[pred];
+	v = &cfg->vertex[succ];
+
+	for (j = 0; j < u->nsucc; ++j)
+		if (u->succ[j] == succ)
+			break;
+
+	if (j == u->nsucc)
+		error("no edge %zu -> %zu", pred, succ);
+
+	u->succ[j] = u->succ[u->nsucc - 1];
+	u->succ = resize(cfg, u->succ, u->nsucc, u->nsucc - 1);
+	u->nsucc -= 1;
+
+	for (j = 0; v->pred[j] != pred; ++j)
+		;
+
+	v->pred[j] = v->pred[v->npred - 1];
+	v->pred = resize(cfg, v->pred, v->npred, v->npred - 1);
+	v->npred -= 1;
+
+	if (shrunk(cfg, u))
+		or(cfg->lost, cfg->lost, v->set[IN]);
 }
 
 bool testbit(cfg_t* cfg, size_t v, set_type_t type, size_t index)
@@ -171,164 +653,1692 @@ bool testbit(cfg_t* cfg, size_t v, set_type_t type, size_t index)
 	return test(cfg->vertex[v].set[type], index);
 }
 
+/* setbit and resetbit: a new DEF or a removed USE can only make
+ * symbols dead, while the opposite edits can only make them live. */
 void setbit(cfg_t* cfg, size_t v, set_type_t type, size_t index)
 {
-	set(cfg->vertex[v].set[type], index);
+	vertex_t*       u;
+
+	u = &cfg->vertex[v];
+
+	if (test(u->set[type], index))
+		return;
+
+	set(u->set[type], index);
+
+	if (type == DEF && shrunk(cfg, u))
+		set(cfg->lost, index);
+	else if (type == USE)
+		edited(cfg, u);
+}
+
+void resetbit(cfg_t* cfg, size_t v, set_type_t type, size_t index)
+{
+	vertex_t*       u;
+
+	u = &cfg->vertex[v];
+
+	if (!test(u->set[type], index))
+		return;
+
+	clear(u->set[type], index);
+
+	if (type == USE && shrunk(cfg, u))
+		set(cfg->lost, index);
+	else if (type == DEF)
+		edited(cfg, u);
 }
 
-void single(vertex_t *u, queue_t *worklist){
+static void list_preds(vertex_t *u, task_t *task)
+{
 	vertex_t*       v;
-	set_t*          prev;
 	size_t          j;
-	list_t*         p;
-	list_t*         h;
-	atomic_store(&u->listed, false);
-
-	reset(u->set[OUT]);
-	for (j = 0; j < u->nsucc; ++j) {
-		pthread_spin_lock(&u->succ[j]->inmutex);
-		or(u->set[OUT], u->set[OUT], u->succ[j]->set[IN]);
-		pthread_spin_unlock(&u->succ[j]->inmutex);
-	}
-
-	pthread_spin_lock(&u->inmutex);
-	prev = u->prev;
-	u->prev = u->set[IN];
-	u->set[IN] = prev;
-
-	/* in our case liveness information... */
-	propagate(u->set[IN], u->set[OUT], u->set[DEF], u->set[USE]);
-
-	if (u->pred != NULL && !equal(u->prev, u->set[IN])) {
-		pthread_spin_unlock(&u->inmutex);
-		p = h = u->pred;
-		do {
-			v = p->data;
-			bool expected = false;
-			if (atomic_compare_exchange_strong(&v->listed, &expected, true)) {
-				v->listed = true;
-				q_insert(worklist, v);
-			} else {
-			}
-
-			p = p->succ;
 
-		} while (p != h);
-	} else {
-		pthread_spin_unlock(&u->inmutex);
+	for (j = 0; j < u->npred; ++j) {
+		v = &task->cfg->vertex[u->pred[j]];
+		bool expected = false;
+		if (atomic_compare_exchange_strong(&v->sync->listed, &expected, true))
+			q_insert(task->worklist, v, task->nodes, task->stats);
+		else if (task->stats != NULL)
+			task->stats->casfail += 1;
 	}
 }
 
-void first(vertex_t *u, queue_t *worklist){
+static void list_succs(vertex_t *u, task_t *task)
+{
 	vertex_t*       v;
-	set_t*          prev;
 	size_t          j;
-	list_t*         p;
-	list_t*         h;
-	// printf("%s\n", "entering first" );
 
 	for (j = 0; j < u->nsucc; ++j) {
+		v = &task->cfg->vertex[u->succ[j]];
 		bool expected = false;
-		// printf("%s\n", "found predecessor" );
-		v = u-> succ[j];
-		if (atomic_compare_exchange_strong(&v->listed, &expected, true)) {
-			// printf("%s\n", "was not listed" );
+		if (atomic_compare_exchange_strong(&v->sync->listed, &expected, true))
+			q_insert(task->worklist, v, task->nodes, task->stats);
+		else if (task->stats != NULL)
+			task->stats->casfail += 1;
+	}
+}
+
+/* read_set: meet t with set type of v without taking a lock, reading
+ * its words with relaxed atomic loads. the seq of v is odd while v
+ * writes it and the read is repeated if it changed meanwhile. each
+ * word of a torn read is either the old or the new word, and a set
+ * only grows (union) or shrinks (intersection) while the solver runs,
+ * so meeting with a torn read and then with the new set is the same
+ * as only meeting with the new set. */
+static void read_set(set_t* t, vertex_t* v, set_type_t type, meet_t meet)
+{
+	unsigned        seq;
 
-			first(v, worklist);
+	for (;;) {
+		seq = atomic_load_explicit(&v->sync->seq, memory_order_acquire);
+		if (seq & 1) {
+			sched_yield();
+			continue;
 		}
+
+		if (meet == UNION)
+			or_relaxed(t, v->set[type]);
+		else
+			and_relaxed(t, v->set[type]);
+
+		atomic_thread_fence(memory_order_acquire);
+		if (atomic_load_explicit(&v->sync->seq, memory_order_relaxed) == seq)
+			return;
 	}
-	atomic_store(&u->listed, false);
+}
 
-	reset(u->set[OUT]);
-	for (j = 0; j < u->nsucc; ++j) {
-		pthread_spin_lock(&u->succ[j]->inmutex);
-		or(u->set[OUT], u->set[OUT], u->succ[j]->set[IN]);
-		pthread_spin_unlock(&u->succ[j]->inmutex);
-	}
-
-	pthread_spin_lock(&u->inmutex);
-	prev = u->prev;
-	u->prev = u->set[IN];
-	u->set[IN] = prev;
-
-	/* in our case liveness information... */
-	propagate(u->set[IN], u->set[OUT], u->set[DEF], u->set[USE]);
-
-	if (u->pred != NULL && !equal(u->prev, u->set[IN])) {
-		pthread_spin_unlock(&u->inmutex);
-		p = h = u->pred;
-		do {
-			v = p->data;
-			bool expected = false;
-			if (atomic_compare_exchange_strong(&v->listed, &expected, true)) {
-				q_insert(worklist, v);
-			}
-			p = p->succ;
-		} while (p != h);
+/* gather: set the input of u, OUT for a backward problem and IN for a
+ * forward one, to the meet of the outputs of its neighbours. */
+static set_t* gather(cfg_t* cfg, vertex_t* u)
+{
+	problem_t*      problem = &cfg->problem;
+	set_type_t      after;
+	set_t*          t;
+	size_t          j;
+
+	t = u->set[problem->direction == BACKWARD ? OUT : IN];
+	after = problem->direction == BACKWARD ? IN : OUT;
+
+	if (problem->direction == BACKWARD) {
+		if (problem->meet == UNION || u->nsucc == 0)
+			reset(t);
+		else
+			fill(t, cfg->nsymbol);
+
+		for (j = 0; j < u->nsucc; ++j)
+			read_set(t, &cfg->vertex[u->succ[j]], after, problem->meet);
 	} else {
-		pthread_spin_unlock(&u->inmutex);
+		if (problem->meet == UNION || u->npred == 0)
+			reset(t);
+		else
+			fill(t, cfg->nsymbol);
+
+		for (j = 0; j < u->npred; ++j)
+			read_set(t, &cfg->vertex[u->pred[j]], after, problem->meet);
 	}
+
+	return t;
 }
 
+/* single: for liveness, OUT is the union of the successor IN sets and
+ * IN = USE | (OUT - DEF). other problems swap IN and OUT, successors and
+ * predecessors, or union and intersection. */
+void single(vertex_t *u, task_t *task){
+	problem_t*      problem = &task->cfg->problem;
+	set_type_t      after;
+	set_t*          t;
+	unsigned        seq;
+	bool            changed;
 
-void *work(void *arg)
-{
-	vertex_t*       u;
-	queue_t *worklist = (queue_t *) arg;
-	u = q_remove(worklist);
-	if(u!=NULL){
-		first( u, worklist );
-	}
-	while ((u = q_remove(worklist)) != NULL) {
-		single(u, worklist);
-	}
-	return NULL;
+	after = problem->direction == BACKWARD ? IN : OUT;
+
+	/* another worker may pop u again as soon as listed is cleared,
+	 * so OUT and IN are only written while listmutex is held, which
+	 * also makes the owner the only writer of u->sync->seq. */
+	lock(&u->sync->listmutex, task->stats);
+	atomic_store(&u->sync->listed, false);
+
+	t = gather(task->cfg, u);
+
+	/* in our case liveness information... IN is rewritten in place
+	 * and the change is detected in the same pass. */
+	seq = atomic_load_explicit(&u->sync->seq, memory_order_relaxed);
+	atomic_store_explicit(&u->sync->seq, seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	changed = propagate_relaxed(u->set[after], t, u->set[DEF], u->set[USE]);
+	atomic_store_explicit(&u->sync->seq, seq + 2, memory_order_release);
+	pthread_spin_unlock(&u->sync->listmutex);
+	visit(task, u, changed);
+
+	if (!changed)
+		return;
+
+	if (problem->direction == BACKWARD)
+		list_preds(u, task);
+	else
+		list_succs(u, task);
 }
 
-void liveness(cfg_t* cfg)
+/* monotone: single() for a union problem solved from below, where IN
+ * and OUT only grow. both are merged into with fetch_or, so no lock is
+ * taken and several threads may process u at once, and a thread knows
+ * u changed when its fetch_or added bits. the words are written before
+ * the CAS on listed of a neighbour and read after listed of u is
+ * cleared, so a neighbour is either listed again or sees the bits. */
+void monotone(vertex_t *u, task_t *task)
 {
-	vertex_t*       u;
-	size_t          i;
-	queue_t*         worklist = q_new();
-	pthread_t threads[NTHREADS];
-	int err;
+	cfg_t*          cfg = task->cfg;
+	problem_t*      problem = &cfg->problem;
+	set_type_t      before;
+	set_type_t      after;
+	uint32_t*       from;
+	size_t          n;
+	size_t          j;
+	bool            changed;
 
-	for (i = 0; i < NTHREADS; ++i) {
-		u = &cfg->vertex[i];
-		q_insert(worklist, u);
-		u->listed = true;
-	}
+	atomic_store(&u->sync->listed, false);
 
-	for (i = 0; i < NTHREADS; ++i) {
-		err = pthread_create(&threads[i], NULL, work, worklist);
-		if (err)
-			error("Failed to create thread");
-	}
+	before = problem->direction == BACKWARD ? OUT : IN;
+	after = problem->direction == BACKWARD ? IN : OUT;
+	from = problem->direction == BACKWARD ? u->succ : u->pred;
+	n = problem->direction == BACKWARD ? u->nsucc : u->npred;
 
-	for (i = 0; i < NTHREADS; ++i) {
-		err = pthread_join(threads[i], NULL);
-		if (err)
-			error("Failed to join thread");
+	for (j = 0; j < n; ++j)
+		or_atomic(u->set[before], cfg->vertex[from[j]].set[after]);
+
+	changed = propagate_atomic(u->set[after], u->set[before], u->set[DEF], u->set[USE]);
+	visit(task, u, changed);
+
+	if (!changed)
+		return;
+
+	if (problem->direction == BACKWARD)
+		list_preds(u, task);
+	else
+		list_succs(u, task);
+}
+
+/* incremental: u takes the bits its successors have added to their IN
+ * since u was last processed, and hands on only what that adds to its
+ * own IN. USE is included every time but only matters on the first. */
+void incremental(vertex_t *u, task_t *task){
+	vertex_t*       v;
+	set_t*          d;
+	size_t          j;
+	bool            changed;
+
+	lock(&u->sync->listmutex, task->stats);
+	atomic_store(&u->sync->listed, false);
+
+	lock(&u->sync->deltamutex, task->stats);
+	d = u->delta;
+	u->delta = task->scratch;
+	pthread_spin_unlock(&u->sync->deltamutex);
+
+	changed = accumulate(u->set[IN], u->set[OUT], u->set[DEF], u->set[USE], d);
+	pthread_spin_unlock(&u->sync->listmutex);
+	visit(task, u, changed);
+
+	if (changed) {
+		for (j = 0; j < u->npred; ++j) {
+			v = &task->cfg->vertex[u->pred[j]];
+			lock(&v->sync->deltamutex, task->stats);
+			or(v->delta, v->delta, d);
+			pthread_spin_unlock(&v->sync->deltamutex);
+		}
+		list_preds(u, task);
 	}
-	q_free(worklist);
+
+	reset(d);
+	task->scratch = d;
 }
 
-void print_sets(cfg_t* cfg, FILE *fp)
+/* new_scc: iterative Tarjan. a component is completed only after
+ * every component reachable from it, which is the order a backward
+ * problem wants to solve them in. */
+static scc_t* new_scc(cfg_t* cfg)
 {
+	scc_t*          scc;
+	size_t          n;
 	size_t          i;
+	size_t          j;
+	size_t          v;
+	size_t          w;
+	size_t          c;
+	size_t          counter;
+	size_t          ncall;
+	size_t          ntarjan;
+	size_t          nmember;
+	size_t*         index;
+	size_t*         low;
+	size_t*         tarjan;
+	size_t*         call;
+	size_t*         next;
+	bool*           onstack;
 	vertex_t*       u;
 
-	for (i = 0; i < cfg->nvertex; ++i) {
-		u = &cfg->vertex[i];
-		fprintf(fp, "use[%zu] = ", u->index);
-		print_set(u->set[USE], fp);
-		fprintf(fp, "def[%zu] = ", u->index);
-		print_set(u->set[DEF], fp);
-		fputc('\n', fp);
-		fprintf(fp, "in[%zu] = ", u->index);
-		print_set(u->set[IN], fp);
-		fprintf(fp, "out[%zu] = ", u->index);
-		print_set(u->set[OUT], fp);
-		fputc('\n', fp);
+	n = cfg->nvertex;
+	scc = calloc(1, sizeof(scc_t));
+	index = malloc(n * sizeof index[0]);
+	low = malloc(n * sizeof low[0]);
+	tarjan = malloc(n * sizeof tarjan[0]);
+	call = malloc(n * sizeof call[0]);
+	next = malloc(n * sizeof next[0]);
+	onstack = calloc(n, sizeof onstack[0]);
+	scc->comp = malloc(n * sizeof scc->comp[0]);
+	scc->first = malloc((n + 1) * sizeof scc->first[0]);
+	scc->member = malloc(n * sizeof scc->member[0]);
+
+	if (scc == NULL || index == NULL || low == NULL || tarjan == NULL
+		|| call == NULL || next == NULL || onstack == NULL
+		|| scc->comp == NULL || scc->first == NULL || scc->member == NULL)
+		error("out of memory");
+
+	for (i = 0; i < n; ++i)
+		index[i] = SIZE_MAX;
+
+	counter = ntarjan = nmember = 0;
+
+	for (i = 0; i < n; ++i) {
+		if (index[i] != SIZE_MAX)
+			continue;
+
+		ncall = 0;
+		call[ncall] = i;
+		next[ncall++] = 0;
+		index[i] = low[i] = counter++;
+		tarjan[ntarjan++] = i;
+		onstack[i] = true;
+
+		while (ncall > 0) {
+			v = call[ncall-1];
+			u = &cfg->vertex[v];
+
+			if (next[ncall-1] < u->nsucc) {
+				w = u->succ[next[ncall-1]++];
+				if (index[w] == SIZE_MAX) {
+					index[w] = low[w] = counter++;
+					tarjan[ntarjan++] = w;
+					onstack[w] = true;
+					call[ncall] = w;
+					next[ncall++] = 0;
+				} else if (onstack[w] && index[w] < low[v])
+					low[v] = index[w];
+				continue;
+			}
+
+			ncall -= 1;
+
+			if (low[v] == index[v]) {
+				c = scc->ncomp++;
+				scc->first[c] = nmember;
+				do {
+					w = tarjan[--ntarjan];
+					onstack[w] = false;
+					scc->comp[w] = c;
+					scc->member[nmember++] = &cfg->vertex[w];
+				} while (w != v);
+
+				if (nmember - scc->first[c] > scc->maxcomp)
+					scc->maxcomp = nmember - scc->first[c];
+			}
+
+			if (ncall > 0 && low[v] < low[call[ncall-1]])
+				low[call[ncall-1]] = low[v];
+		}
 	}
+
+	scc->first[scc->ncomp] = nmember;
+
+	free(index);
+	free(low);
+	free(tarjan);
+	free(call);
+	free(next);
+	free(onstack);
+
+	scc->waiting = calloc(scc->ncomp, sizeof scc->waiting[0]);
+	scc->ready = malloc(scc->ncomp * sizeof scc->ready[0]);
+	if (scc->waiting == NULL || scc->ready == NULL)
+		error("out of memory");
+
+	for (v = 0; v < n; ++v) {
+		u = &cfg->vertex[v];
+		for (j = 0; j < u->nsucc; ++j)
+			if (scc->comp[u->succ[j]] != scc->comp[v])
+				scc->waiting[scc->comp[v]] += 1;
+	}
+
+	for (c = 0; c < scc->ncomp; ++c)
+		if (scc->waiting[c] == 0)
+			scc->ready[scc->nready++] = c;
+
+	scc->remaining = scc->ncomp;
+	pthread_spin_init(&scc->readymutex, PTHREAD_PROCESS_PRIVATE);
+
+	return scc;
+}
+
+static void free_scc(scc_t* scc)
+{
+	free(scc->comp);
+	free(scc->first);
+	free(scc->member);
+	free(scc->waiting);
+	free(scc->ready);
+	free(scc);
+}
+
+/* component: solve component c to a fixpoint. its successor components
+ * are already solved and no other thread touches its vertices, so
+ * neither IN nor listed needs a lock. an acyclic vertex is processed
+ * exactly once. */
+static void component(task_t* task, size_t c)
+{
+	scc_t*          scc = task->scc;
+	vertex_t*       vertex = task->cfg->vertex;
+	vertex_t*       u;
+	vertex_t*       v;
+	size_t          n;
+	size_t          i;
+	size_t          j;
+	bool            changed;
+
+	n = 0;
+	for (i = scc->first[c]; i < scc->first[c+1]; ++i) {
+		u = scc->member[i];
+		u->sync->listed = true;
+		task->stack[n++] = u;
+	}
+
+	while (n > 0) {
+		u = task->stack[--n];
+		u->sync->listed = false;
+
+		reset(u->set[OUT]);
+		for (j = 0; j < u->nsucc; ++j)
+			or(u->set[OUT], u->set[OUT], vertex[u->succ[j]].set[IN]);
+
+		changed = propagate(u->set[IN], u->set[OUT], u->set[DEF], u->set[USE]);
+		visit(task, u, changed);
+
+		if (!changed)
+			continue;
+
+		for (j = 0; j < u->npred; ++j) {
+			v = &vertex[u->pred[j]];
+			if (scc->comp[v->index] == c && !v->sync->listed) {
+				v->sync->listed = true;
+				task->stack[n++] = v;
+			}
+		}
+	}
+}
+
+static void components(task_t* task)
+{
+	scc_t*          scc = task->scc;
+	vertex_t*       u;
+	size_t          c;
+	size_t          d;
+	size_t          i;
+	size_t          j;
+
+	for (;;) {
+		lock(&scc->readymutex, task->stats);
+		if (scc->nready == 0) {
+			pthread_spin_unlock(&scc->readymutex);
+			if (scc->remaining == 0)
+				return;
+			sched_yield();
+			continue;
+		}
+		c = scc->ready[--scc->nready];
+		if (due(task->stats))
+			sample(task->stats, scc->nready);
+		pthread_spin_unlock(&scc->readymutex);
+
+		component(task, c);
+
+		/* release the predecessor components. */
+		for (i = scc->first[c]; i < scc->first[c+1]; ++i) {
+			u = scc->member[i];
+			for (j = 0; j < u->npred; ++j) {
+				d = scc->comp[u->pred[j]];
+				if (d != c && atomic_fetch_sub(&scc->waiting[d], 1) == 1) {
+					lock(&scc->readymutex, task->stats);
+					scc->ready[scc->nready++] = d;
+					pthread_spin_unlock(&scc->readymutex);
+				}
+			}
+		}
+
+		atomic_fetch_sub(&scc->remaining, 1);
+	}
+}
+
+/* new_partition: grow each region breadth first over both successor
+ * and predecessor edges until it holds its share of the vertices, so
+ * that regions are connected and few edges cross between them. */
+static partition_t* new_partition(cfg_t* cfg)
+{
+	partition_t*    part;
+	vertex_t**      queue;
+	vertex_t*       u;
+	vertex_t*       v;
+	size_t          share;
+	size_t          head;
+	size_t          tail;
+	size_t          i;
+	size_t          j;
+	size_t          k;
+
+	part = calloc(1, sizeof(partition_t));
+	queue = malloc(cfg->nvertex * sizeof queue[0]);
+	if (part == NULL || queue == NULL)
+		error("out of memory");
+
+	part->part = malloc(cfg->nvertex * sizeof part->part[0]);
+	if (part->part == NULL)
+		error("out of memory");
+
+	for (i = 0; i < cfg->nvertex; ++i)
+		part->part[i] = NTHREADS;
+
+	share = (cfg->nvertex + NTHREADS - 1) / NTHREADS;
+	head = tail = 0;
+	k = 0;
+
+	/* NTHREADS means unseen and NTHREADS + 1 queued. */
+	for (i = 0; i < cfg->nvertex; ++i) {
+		if (part->part[i] != NTHREADS)
+			continue;
+
+		part->part[i] = NTHREADS + 1;
+		queue[tail++] = &cfg->vertex[i];
+
+		while (head < tail) {
+			u = queue[head++];
+
+			if (part->size[k] == share)
+				k += 1;
+
+			part->part[u->index] = k;
+			part->size[k] += 1;
+
+			for (j = 0; j < u->nsucc; ++j) {
+				v = &cfg->vertex[u->succ[j]];
+				if (part->part[v->index] == NTHREADS) {
+					part->part[v->index] = NTHREADS + 1;
+					queue[tail++] = v;
+				}
+			}
+
+			for (j = 0; j < u->npred; ++j) {
+				v = &cfg->vertex[u->pred[j]];
+				if (part->part[v->index] == NTHREADS) {
+					part->part[v->index] = NTHREADS + 1;
+					queue[tail++] = v;
+				}
+			}
+		}
+	}
+
+	free(queue);
+
+	for (k = 0; k < NTHREADS; ++k)
+		pthread_spin_init(&part->mailmutex[k], PTHREAD_PROCESS_PRIVATE);
+
+	part->busy = NTHREADS;
+
+	return part;
+}
+
+static void free_partition(partition_t* part)
+{
+	message_t*      m;
+	size_t          k;
+
+	for (k = 0; k < NTHREADS; ++k)
+		while ((m = part->spare[k]) != NULL) {
+			part->spare[k] = m->next;
+			free_set(m->bits);
+			free(m);
+		}
+
+	free(part->part);
+	free(part);
+}
+
+static void send(task_t* task, size_t k, vertex_t* to, set_t* bits)
+{
+	partition_t*    part = task->part;
+	message_t*      m;
+
+	m = part->spare[task->id];
+	if (m != NULL)
+		part->spare[task->id] = m->next;
+	else {
+		m = malloc(sizeof(message_t));
+		if (m == NULL)
+			error("out of memory");
+		m->bits = new_set(bits->n * 64);
+	}
+
+	m->to = to;
+	or(m->bits, m->bits, bits);
+
+	atomic_fetch_add(&part->busy, 1);
+
+	lock(&part->mailmutex[k], task->stats);
+	m->next = atomic_load_explicit(&part->mailbox[k], memory_order_relaxed);
+	atomic_store_explicit(&part->mailbox[k], m, memory_order_relaxed);
+	pthread_spin_unlock(&part->mailmutex[k]);
+}
+
+/* receive: add all received bits to the pending deltas. returns false
+ * if the mailbox was empty. */
+static bool receive(task_t* task)
+{
+	partition_t*    part = task->part;
+	message_t*      m;
+	message_t*      next;
+	size_t          n;
+
+	if (atomic_load(&part->mailbox[task->id]) == NULL)
+		return false;
+
+	lock(&part->mailmutex[task->id], task->stats);
+	m = atomic_load_explicit(&part->mailbox[task->id], memory_order_relaxed);
+	atomic_store_explicit(&part->mailbox[task->id], NULL, memory_order_relaxed);
+	pthread_spin_unlock(&part->mailmutex[task->id]);
+
+	for (n = 0; m != NULL; m = next, ++n) {
+		next = m->next;
+		or(m->to->delta, m->to->delta, m->bits);
+		if (!m->to->sync->listed) {
+			m->to->sync->listed = true;
+			task->stack[task->nstack++] = m->to;
+		}
+		reset(m->bits);
+		m->next = part->spare[task->id];
+		part->spare[task->id] = m;
+	}
+
+	atomic_fetch_sub(&part->busy, n);
+
+	return n > 0;
+}
+
+/* region: the delta solver restricted to the vertices of one region.
+ * only the owner touches their sets and listed flags, so only the
+ * mailboxes need locks. busy counts the threads that are not idle and
+ * the messages not yet received, so when it is zero nothing more can
+ * happen. */
+static void region(task_t* task)
+{
+	partition_t*    part = task->part;
+	vertex_t*       u;
+	vertex_t*       v;
+	set_t*          d;
+	size_t          j;
+	size_t          k;
+	bool            changed;
+
+	for (;;) {
+		receive(task);
+
+		while (task->nstack > 0) {
+			u = task->stack[--task->nstack];
+			u->sync->listed = false;
+
+			d = u->delta;
+			u->delta = task->scratch;
+
+			changed = accumulate(u->set[IN], u->set[OUT], u->set[DEF], u->set[USE], d);
+			visit(task, u, changed);
+
+			if (changed)
+				for (j = 0; j < u->npred; ++j) {
+					v = &task->cfg->vertex[u->pred[j]];
+					k = part->part[v->index];
+					if (k != task->id)
+						send(task, k, v, d);
+					else {
+						or(v->delta, v->delta, d);
+						if (!v->sync->listed) {
+							v->sync->listed = true;
+							task->stack[task->nstack++] = v;
+						}
+					}
+				}
+
+			reset(d);
+			task->scratch = d;
+
+			if (due(task->stats))
+				sample(task->stats, task->nstack);
+
+			if (task->nstack == 0)
+				receive(task);
+		}
+
+		atomic_fetch_sub(&part->busy, 1);
+
+		for (;;) {
+			if (atomic_load(&part->mailbox[task->id]) != NULL) {
+				atomic_fetch_add(&part->busy, 1);
+				break;
+			}
+			if (part->busy == 0)
+				return;
+			sched_yield();
+		}
+	}
+}
+
+/* postorder: vertex indices in depth-first postorder over successor
+ * edges, i.e. the reverse postorder of the reversed cfg, in which a
+ * backward problem sees successors before predecessors except along
+ * back edges. */
+static size_t* postorder(cfg_t* cfg)
+{
+	size_t*         order;
+	size_t*         call;
+	size_t*         next;
+	bool*           seen;
+	vertex_t*       u;
+	size_t          n;
+	size_t          ncall;
+	size_t          i;
+	size_t          v;
+	size_t          w;
+
+	order = malloc(cfg->nvertex * sizeof order[0]);
+	call = malloc(cfg->nvertex * sizeof call[0]);
+	next = malloc(cfg->nvertex * sizeof next[0]);
+	seen = calloc(cfg->nvertex, sizeof seen[0]);
+
+	if (order == NULL || call == NULL || next == NULL || seen == NULL)
+		error("out of memory");
+
+	n = 0;
+
+	for (i = 0; i < cfg->nvertex; ++i) {
+		if (seen[i])
+			continue;
+
+		seen[i] = true;
+		ncall = 0;
+		call[ncall] = i;
+		next[ncall++] = 0;
+
+		while (ncall > 0) {
+			v = call[ncall-1];
+			u = &cfg->vertex[v];
+
+			if (next[ncall-1] < u->nsucc) {
+				w = u->succ[next[ncall-1]++];
+				if (!seen[w]) {
+					seen[w] = true;
+					call[ncall] = w;
+					next[ncall++] = 0;
+				}
+			} else {
+				order[n++] = v;
+				ncall -= 1;
+			}
+		}
+	}
+
+	free(call);
+	free(next);
+	free(seen);
+
+	return order;
+}
+
+/* ranks: the postorder number of each vertex, for the worklist. it is
+ * only an order of work, so after edge edits the old ranks are kept and
+ * they are renumbered when fresh, for a solve from scratch. */
+static size_t* ranks(cfg_t* cfg, bool fresh)
+{
+	size_t*         order;
+	size_t          i;
+
+	if (cfg->nvertex == 0 || (cfg->rank != NULL && !fresh))
+		return cfg->rank;
+
+	order = postorder(cfg);
+	if (cfg->rank == NULL)
+		cfg->rank = malloc(cfg->nvertex * sizeof cfg->rank[0]);
+	if (cfg->rank == NULL)
+		error("out of memory");
+
+	for (i = 0; i < cfg->nvertex; ++i)
+		cfg->rank[order[i]] = i;
+
+	free(order);
+
+	return cfg->rank;
+}
+
+/* sequential: round robin over all vertices until nothing changes,
+ * in postorder for backward problems and reverse postorder for forward
+ * ones. it runs in the calling thread and is the reference verify()
+ * checks the other solvers against. */
+static void sequential(cfg_t* cfg)
+{
+	problem_t*      problem = &cfg->problem;
+	vertex_t*       u;
+	size_t*         order;
+	size_t          n;
+	size_t          i;
+	bool            changed;
+
+	order = postorder(cfg);
+	n = cfg->nvertex;
+
+	do {
+		changed = false;
+		for (i = 0; i < n; ++i) {
+			if (problem->direction == BACKWARD)
+				u = &cfg->vertex[order[i]];
+			else
+				u = &cfg->vertex[order[n - 1 - i]];
+
+			if (propagate(u->set[problem->direction == BACKWARD ? IN : OUT],
+				gather(cfg, u), u->set[DEF], u->set[USE]))
+				changed = true;
+		}
+	} while (changed);
+
+	free(order);
+}
+
+static jacobi_t* new_jacobi(cfg_t* cfg, queue_t* worklist)
+{
+	jacobi_t*       jacobi;
+	vertex_t*       u;
+
+	jacobi = calloc(1, sizeof(jacobi_t));
+	if (jacobi == NULL)
+		error("out of memory");
+
+	jacobi->order = postorder(cfg);
+	jacobi->nword = (cfg->nvertex + 63) / 64;
+	jacobi->dirty[0] = calloc(jacobi->nword, sizeof(uint64_t));
+	jacobi->dirty[1] = calloc(jacobi->nword, sizeof(uint64_t));
+
+	if (jacobi->dirty[0] == NULL || jacobi->dirty[1] == NULL)
+		error("out of memory");
+
+	while ((u = q_remove(worklist, cfg->nodes[NTHREADS], NULL)) != NULL) {
+		u->sync->listed = false;
+		jacobi->dirty[0][u->index / 64] |= 1ULL << (u->index % 64);
+	}
+
+	pthread_barrier_init(&jacobi->barrier, NULL, NTHREADS);
+
+	return jacobi;
+}
+
+static void free_jacobi(jacobi_t* jacobi)
+{
+	pthread_barrier_destroy(&jacobi->barrier);
+	free(jacobi->order);
+	free(jacobi->dirty[0]);
+	free(jacobi->dirty[1]);
+	free(jacobi);
+}
+
+/* rounds: each thread owns a fixed chunk of the postorder and of the
+ * dirty bitmap words. only marking the predecessors of a changed vertex
+ * writes outside the own chunk, with an atomic or. */
+static void rounds(task_t* task)
+{
+	jacobi_t*       jacobi = task->jacobi;
+	cfg_t*          cfg = task->cfg;
+	vertex_t*       u;
+	vertex_t*       v;
+	uint64_t*       dirty;
+	uint64_t*       next;
+	size_t          begin;
+	size_t          end;
+	size_t          round;
+	size_t          n;
+	size_t          i;
+	size_t          j;
+	size_t          w;
+	bool            changed;
+
+	begin = task->id * cfg->nvertex / NTHREADS;
+	end = (task->id + 1) * cfg->nvertex / NTHREADS;
+
+	for (round = 0; ; ++round) {
+		dirty = jacobi->dirty[round & 1];
+		next = jacobi->dirty[(round + 1) & 1];
+
+		n = 0;
+		for (i = begin; i < end; ++i) {
+			w = jacobi->order[i];
+			if (!(dirty[w / 64] & (1ULL << (w % 64))))
+				continue;
+
+			u = &cfg->vertex[w];
+			reset(u->set[OUT]);
+			for (j = 0; j < u->nsucc; ++j)
+				or(u->set[OUT], u->set[OUT], cfg->vertex[u->succ[j]].set[IN]);
+
+			changed = stale(u->set[IN], u->set[OUT], u->set[DEF], u->set[USE]);
+			visit(task, u, changed);
+
+			if (changed)
+				task->stack[n++] = u;
+		}
+
+		if (task->stats != NULL)
+			sample(task->stats, n);
+
+		atomic_fetch_add(&jacobi->changed[round & 1], n);
+		pthread_barrier_wait(&jacobi->barrier);
+
+		/* everyone has read the count of the previous round. */
+		if (task->id == 0)
+			jacobi->changed[(round + 1) & 1] = 0;
+
+		for (i = 0; i < n; ++i) {
+			u = task->stack[i];
+			propagate(u->set[IN], u->set[OUT], u->set[DEF], u->set[USE]);
+
+			for (j = 0; j < u->npred; ++j) {
+				v = &cfg->vertex[u->pred[j]];
+				atomic_fetch_or((_Atomic uint64_t*)&next[v->index / 64],
+					1ULL << (v->index % 64));
+			}
+		}
+
+		for (i = task->id * jacobi->nword / NTHREADS;
+			i < (task->id + 1) * jacobi->nword / NTHREADS; ++i)
+			dirty[i] = 0;
+
+		pthread_barrier_wait(&jacobi->barrier);
+
+		if (jacobi->changed[round & 1] == 0) {
+			if (task->id == 0)
+				cfg->rounds = round + 1;
+			return;
+		}
+	}
+}
+
+/* gather_slice: gather() for the slices of task only. */
+static set_t* gather_slice(task_t* task, vertex_t* u)
+{
+	cfg_t*          cfg = task->cfg;
+	problem_t*      problem = &cfg->problem;
+	set_type_t      after;
+	set_t*          t;
+	vertex_t*       v;
+	uint32_t*       from;
+	size_t          n;
+	size_t          j;
+
+	t = u->set[problem->direction == BACKWARD ? OUT : IN];
+	after = problem->direction == BACKWARD ? IN : OUT;
+	from = problem->direction == BACKWARD ? u->succ : u->pred;
+	n = problem->direction == BACKWARD ? u->nsucc : u->npred;
+
+	if (problem->meet == UNION || n == 0)
+		reset_slice(t, task->begin, task->end);
+	else
+		fill_slice(t, cfg->nsymbol, task->begin, task->end);
+
+	for (j = 0; j < n; ++j) {
+		v = &cfg->vertex[from[j]];
+		if (problem->meet == UNION)
+			or_slice(t, t, v->set[after], task->begin, task->end);
+		else
+			and_slice(t, t, v->set[after], task->begin, task->end);
+	}
+
+	return t;
+}
+
+/* slices: the worklist solver for the symbols of the own slices only.
+ * no other thread writes their words, and the worklist and listed
+ * flags are the thread's own, so nothing is locked. the stack starts
+ * with the listed vertices, the lowest rank on top. */
+static void slices(task_t* task)
+{
+	cfg_t*          cfg = task->cfg;
+	problem_t*      problem = &cfg->problem;
+	set_type_t      after;
+	vertex_t*       u;
+	vertex_t*       v;
+	uint32_t*       to;
+	size_t          n;
+	size_t          j;
+	bool            changed;
+
+	if (task->begin == task->end)
+		return;
+
+	after = problem->direction == BACKWARD ? IN : OUT;
+
+	while (task->nstack > 0) {
+		u = task->stack[--task->nstack];
+		task->listed[u->index] = false;
+
+		changed = propagate_slice(u->set[after], gather_slice(task, u),
+			u->set[DEF], u->set[USE], task->begin, task->end);
+		visit(task, u, changed);
+
+		if (due(task->stats))
+			sample(task->stats, task->nstack);
+
+		if (!changed)
+			continue;
+
+		to = problem->direction == BACKWARD ? u->pred : u->succ;
+		n = problem->direction == BACKWARD ? u->npred : u->nsucc;
+
+		for (j = 0; j < n; ++j) {
+			v = &cfg->vertex[to[j]];
+			if (!task->listed[v->index]) {
+				task->listed[v->index] = true;
+				task->stack[task->nstack++] = v;
+			}
+		}
+	}
+}
+
+void *work(void *arg)
+{
+	vertex_t*       u;
+	task_t*         task = arg;
+	queue_t*        worklist = task->worklist;
+
+	if (task->cfg->solver == DELTA) {
+		while ((u = q_remove(worklist, task->nodes, task->stats)) != NULL) {
+			incremental(u, task);
+			if (due(task->stats))
+				sample(task->stats, q_length(worklist));
+		}
+		return NULL;
+	}
+
+	if (task->cfg->solver == SCC) {
+		components(task);
+		return NULL;
+	}
+
+	if (task->cfg->solver == PARTITION) {
+		region(task);
+		return NULL;
+	}
+
+	if (task->cfg->solver == JACOBI) {
+		rounds(task);
+		return NULL;
+	}
+
+	if (task->cfg->solver == SLICED) {
+		slices(task);
+		return NULL;
+	}
+
+	while ((u = q_remove(worklist, task->nodes, task->stats)) != NULL) {
+		if (task->cfg->solver == MONOTONE)
+			monotone(u, task);
+		else
+			single(u, task);
+		if (due(task->stats))
+			sample(task->stats, q_length(worklist));
+	}
+	return NULL;
+}
+
+/* list_all: every vertex must be visited at least once, since USE
+ * alone makes IN non-empty. */
+static void list_all(cfg_t* cfg, queue_t* worklist)
+{
+	vertex_t*       u;
+	size_t          i;
+
+	for (i = 0; i < cfg->nvertex; ++i) {
+		u = &cfg->vertex[i];
+		reset(u->set[IN]);
+		reset(u->set[OUT]);
+		u->sync->listed = true;
+		q_insert(worklist, u, cfg->nodes[NTHREADS], NULL);
+	}
+}
+
+/* list_edits: remove the lost symbols from every vertex they may have
+ * been propagated to from a shrunk vertex, which leaves all sets below
+ * the new solution, and list those vertices and the edited ones. */
+static void list_edits(cfg_t* cfg, queue_t* worklist)
+{
+	vertex_t*       u;
+	vertex_t*       v;
+	vertex_t**      stack;
+	size_t          n;
+	size_t          i;
+	size_t          j;
+	bool            live;
+
+	stack = malloc(cfg->nvertex * sizeof stack[0]);
+	if (stack == NULL)
+		error("out of memory");
+
+	n = 0;
+	for (i = 0; i < cfg->nedit; ++i)
+		if (cfg->edit[i]->shrunk)
+			stack[n++] = cfg->edit[i];
+
+	while (n > 0) {
+		u = stack[--n];
+		live = overlap(u->set[IN], cfg->lost);
+		minus(u->set[IN], u->set[IN], cfg->lost);
+		minus(u->set[OUT], u->set[OUT], cfg->lost);
+
+		if (!live)
+			continue;
+
+		for (j = 0; j < u->npred; ++j) {
+			v = &cfg->vertex[u->pred[j]];
+			if (!v->shrunk && overlap(v->set[OUT], cfg->lost)) {
+				v->shrunk = true;
+				edited(cfg, v);
+				stack[n++] = v;
+			}
+		}
+	}
+
+	free(stack);
+
+	for (i = 0; i < cfg->nedit; ++i) {
+		u = cfg->edit[i];
+		u->edited = false;
+		u->shrunk = false;
+
+		/* the delta solver never recomputes OUT by itself. */
+		if (uses_delta(cfg)) {
+			reset(u->delta);
+			for (j = 0; j < u->nsucc; ++j)
+				or(u->delta, u->delta, cfg->vertex[u->succ[j]].set[IN]);
+		}
+
+		u->sync->listed = true;
+		q_insert(worklist, u, cfg->nodes[NTHREADS], NULL);
+	}
+
+	cfg->nedit = 0;
+
+	if (cfg->lost != NULL)
+		reset(cfg->lost);
+}
+
+static team_t* team;            /* shared by every cfg          */
+static pthread_once_t started = PTHREAD_ONCE_INIT;
+
+static void start_team(void)
+{
+	team = new_team(NTHREADS);
+}
+
+/* workers: the threads of the process, which are started by the first
+ * solve and then reused by every cfg. they are never joined, since
+ * error() may exit from one of them. */
+static team_t* workers(void)
+{
+	pthread_once(&started, start_team);
+
+	return team;
+}
+
+static void solve(cfg_t* cfg, queue_t* worklist)
+{
+	size_t          i;
+	task_t tasks[NTHREADS];
+	scc_t*          scc;
+	partition_t*    part;
+	jacobi_t*       jacobi;
+	vertex_t*       u;
+	vertex_t**      seed;
+	size_t          nseed;
+	size_t          nslice;
+	size_t          j;
+	double          begin;
+
+	begin = now();
+	scc = NULL;
+	part = NULL;
+	jacobi = NULL;
+
+	if (cfg->stats != NULL) {
+		for (i = 0; i < NTHREADS; ++i) {
+			free(cfg->stats[i].sample);
+			memset(&cfg->stats[i], 0, sizeof cfg->stats[i]);
+			cfg->stats[i].begin = begin;
+		}
+		for (i = 0; i < cfg->nvertex; ++i)
+			cfg->visits[i] = 0;
+		cfg->rounds = 0;
+	}
+
+	/* the round robin visits every vertex anyway. */
+	if (cfg->solver == SEQUENTIAL) {
+		while ((u = q_remove(worklist, cfg->nodes[NTHREADS], NULL)) != NULL)
+			u->sync->listed = false;
+		sequential(cfg);
+		cfg->used = cfg->solver;
+		cfg->time = now() - begin;
+		return;
+	}
+
+	/* the components solve every vertex and keep their own lists. */
+	if (cfg->solver == SCC) {
+		while (q_remove(worklist, cfg->nodes[NTHREADS], NULL) != NULL)
+			;
+		scc = new_scc(cfg);
+	}
+
+	if (cfg->solver == PARTITION)
+		part = new_partition(cfg);
+
+	if (cfg->solver == JACOBI)
+		jacobi = new_jacobi(cfg, worklist);
+
+	/* every slice starts from all the listed vertices, which come off
+	 * the worklist lowest rank first. */
+	seed = NULL;
+	nseed = 0;
+	if (cfg->solver == SLICED) {
+		seed = malloc(cfg->nvertex * sizeof seed[0]);
+		if (cfg->nvertex > 0 && seed == NULL)
+			error("out of memory");
+		while ((u = q_remove(worklist, cfg->nodes[NTHREADS], NULL)) != NULL) {
+			u->sync->listed = false;
+			seed[nseed++] = u;
+		}
+	}
+
+	nslice = (cfg->nsymbol + SLICE - 1) / SLICE;
+
+	for (i = 0; i < NTHREADS; ++i) {
+		tasks[i].cfg = cfg;
+		tasks[i].worklist = worklist;
+		tasks[i].scratch = NULL;
+		tasks[i].scc = scc;
+		tasks[i].stack = NULL;
+		tasks[i].nstack = 0;
+		tasks[i].part = part;
+		tasks[i].id = i;
+		tasks[i].jacobi = jacobi;
+		tasks[i].stats = cfg->stats == NULL ? NULL : &cfg->stats[i];
+		tasks[i].nodes = cfg->nodes[i];
+		tasks[i].listed = NULL;
+		tasks[i].begin = i * nslice / NTHREADS;
+		tasks[i].end = (i + 1) * nslice / NTHREADS;
+		if (uses_delta(cfg))
+			tasks[i].scratch = new_set(cfg->nsymbol);
+		if (scc != NULL) {
+			tasks[i].stack = malloc(scc->maxcomp * sizeof(vertex_t*));
+			if (tasks[i].stack == NULL)
+				error("out of memory");
+		}
+		if (part != NULL) {
+			tasks[i].stack = malloc(part->size[i] * sizeof(vertex_t*));
+			if (part->size[i] > 0 && tasks[i].stack == NULL)
+				error("out of memory");
+		}
+		if (jacobi != NULL) {
+			tasks[i].stack = malloc((cfg->nvertex / NTHREADS + 1) * sizeof(vertex_t*));
+			if (tasks[i].stack == NULL)
+				error("out of memory");
+		}
+		if (seed != NULL) {
+			tasks[i].stack = malloc(cfg->nvertex * sizeof(vertex_t*));
+			tasks[i].listed = calloc(cfg->nvertex, sizeof(bool));
+			if (cfg->nvertex > 0 && (tasks[i].stack == NULL || tasks[i].listed == NULL))
+				error("out of memory");
+			for (j = nseed; j > 0; --j) {
+				u = seed[j-1];
+				tasks[i].listed[u->index] = true;
+				tasks[i].stack[tasks[i].nstack++] = u;
+			}
+		}
+	}
+
+	free(seed);
+
+	/* each region starts from its own share of the listed vertices. */
+	if (part != NULL)
+		while ((u = q_remove(worklist, cfg->nodes[NTHREADS], NULL)) != NULL) {
+			i = part->part[u->index];
+			tasks[i].stack[tasks[i].nstack++] = u;
+		}
+
+	run(workers(), work, tasks, sizeof tasks[0]);
+
+	for (i = 0; i < NTHREADS; ++i) {
+		free_set(tasks[i].scratch);
+		free(tasks[i].stack);
+		free(tasks[i].listed);
+	}
+
+	if (scc != NULL)
+		free_scc(scc);
+
+	if (part != NULL)
+		free_partition(part);
+
+	if (jacobi != NULL)
+		free_jacobi(jacobi);
+
+	cfg->used = cfg->solver;
+	cfg->time = now() - begin;
+}
+
+/* prepare: list the vertices liveness() must solve. */
+static void prepare(cfg_t* cfg, queue_t* worklist)
+{
+	size_t          i;
+
+	if (uses_delta(cfg))
+		for (i = 0; i < cfg->nvertex; ++i)
+			if (cfg->vertex[i].delta == NULL)
+				cfg->vertex[i].delta = new_set(cfg->nsymbol);
+
+	cfg->problem = live;
+	q_order(worklist, ranks(cfg, !cfg->solved), cfg->nvertex, false);
+
+	if (cfg->solved)
+		list_edits(cfg, worklist);
+	else
+		list_all(cfg, worklist);
+
+	cfg->solved = true;
+}
+
+/* whole: the solver visits every vertex whatever was listed, or builds
+ * its regions, rounds or slices over the whole cfg first, so a re-solve
+ * after edits would cost as much as the first solve. */
+static bool whole(solver_t solver)
+{
+	return solver == SCC || solver == PARTITION || solver == JACOBI || solver == SLICED;
+}
+
+/* liveness: a re-solve with a solver which visits every vertex is done
+ * by the worklist solver instead, which only visits those listed. */
+void liveness(cfg_t* cfg)
+{
+	queue_t*         worklist = q_new();
+	solver_t         solver = cfg->solver;
+
+	if (cfg->solved && whole(solver))
+		cfg->solver = WORKLIST;
+
+	prepare(cfg, worklist);
+	solve(cfg, worklist);
+	cfg->solver = solver;
+	q_free(worklist);
+}
+
+/* batch_t: the cfgs of liveness_batch and the next one to be taken. */
+typedef struct {
+	cfg_t**         cfg;
+	size_t          ncfg;
+	_Atomic size_t  next;
+} batch_t;
+
+/* alone: take one cfg at a time and solve it with the worklist solver
+ * in this thread only, so its locks are never contended. the worklist
+ * and task are reused for every cfg and the nodes come from the pool
+ * of the cfg. */
+static void* alone(void* arg)
+{
+	batch_t*        batch = arg;
+	queue_t*        worklist = q_new();
+	task_t          task;
+	cfg_t*          cfg;
+	vertex_t*       u;
+	solver_t        solver;
+	size_t          i;
+
+	memset(&task, 0, sizeof task);
+	task.worklist = worklist;
+
+	while ((i = atomic_fetch_add(&batch->next, 1)) < batch->ncfg) {
+		cfg = batch->cfg[i];
+		solver = cfg->solver;
+		cfg->solver = WORKLIST;
+		task.cfg = cfg;
+		task.nodes = cfg->nodes[NTHREADS];
+
+		prepare(cfg, worklist);
+		while ((u = q_remove(worklist, task.nodes, NULL)) != NULL)
+			single(u, &task);
+
+		cfg->solver = solver;
+	}
+
+	q_free(worklist);
+
+	return NULL;
+}
+
+/* liveness_batch: every thread of the team runs alone() on the same
+ * batch, so the element size given to run is zero. */
+void liveness_batch(cfg_t** cfg, size_t ncfg)
+{
+	batch_t         batch;
+
+	batch.cfg = cfg;
+	batch.ncfg = ncfg;
+	batch.next = 0;
+
+	run(workers(), alone, &batch, 0);
+}
+
+/* restart: list every vertex for solving problem from scratch. a must
+ * problem starts from the full set and shrinks. */
+static void restart(cfg_t* cfg, problem_t problem, queue_t* worklist)
+{
+	size_t          i;
+	set_type_t      after;
+
+	q_order(worklist, ranks(cfg, true), cfg->nvertex, problem.direction == FORWARD);
+	list_all(cfg, worklist);
+
+	after = problem.direction == BACKWARD ? IN : OUT;
+
+	if (problem.meet == INTERSECTION)
+		for (i = 0; i < cfg->nvertex; ++i)
+			fill(cfg->vertex[i].set[after], cfg->nsymbol);
+
+	cfg->problem = problem;
+}
+
+/* dataflow: a must problem starts from the full set and shrinks. the
+ * sets are not liveness, so a later liveness() starts from scratch.
+ * the other solvers are written for liveness only, and monotone needs
+ * sets which only grow. */
+void dataflow(cfg_t* cfg, problem_t problem)
+{
+	queue_t*        worklist;
+
+	switch (cfg->solver) {
+	case WORKLIST:
+	case SLICED:
+	case SEQUENTIAL:
+		break;
+
+	case MONOTONE:
+		if (problem.meet == UNION)
+			break;
+		/* fall through */
+
+	default:
+		error("the %s solver cannot solve this problem", solver_name[cfg->solver]);
+	}
+
+	worklist = q_new();
+	restart(cfg, problem, worklist);
+	cfg->solved = false;
+	solve(cfg, worklist);
+	q_free(worklist);
+}
+
+/* output_t: the text one thread formats for print_sets. */
+typedef struct {
+	cfg_t*          cfg;
+	size_t          begin;
+	size_t          end;
+	char*           buf;
+	size_t          size;
+} output_t;
+
+static char* label(char* p, const char* name, size_t index)
+{
+	while (*name != 0)
+		*p++ = *name++;
+
+	*p++ = '[';
+	p = utoa(p, index);
+	memcpy(p, "] = ", 4);
+
+	return p + 4;
+}
+
+static void* output(void* arg)
+{
+	output_t*       out = arg;
+	vertex_t*       u;
+	size_t          digits;
+	size_t          size;
+	size_t          i;
+	size_t          x;
+	char*           p;
+
+	for (digits = 1, x = out->cfg->nsymbol; x >= 10; x /= 10)
+		digits += 1;
+
+	size = 0;
+	for (i = out->begin; i < out->end; ++i) {
+		u = &out->cfg->vertex[i];
+		size += 4 * (4 + 28) + 2;
+		size += (digits + 1) * (count(u->set[USE]) + count(u->set[DEF])
+			+ count(u->set[IN]) + count(u->set[OUT]));
+	}
+
+	out->buf = malloc(size);
+	if (out->buf == NULL && size > 0)
+		error("out of memory");
+
+	p = out->buf;
+	for (i = out->begin; i < out->end; ++i) {
+		u = &out->cfg->vertex[i];
+		p = label(p, "use", u->index);
+		p = format_set(u->set[USE], p);
+		p = label(p, "def", u->index);
+		p = format_set(u->set[DEF], p);
+		*p++ = '\n';
+		p = label(p, "in", u->index);
+		p = format_set(u->set[IN], p);
+		p = label(p, "out", u->index);
+		p = format_set(u->set[OUT], p);
+		*p++ = '\n';
+	}
+
+	out->size = p - out->buf;
+
+	return NULL;
+}
+
+/* print_sets: each thread formats a range of vertices into its own
+ * buffer, found by counting the elements first, and the buffers are
+ * then written in order. */
+void print_sets(cfg_t* cfg, FILE *fp)
+{
+	size_t          i;
+	output_t        out[NTHREADS];
+
+	for (i = 0; i < NTHREADS; ++i) {
+		out[i].cfg = cfg;
+		out[i].begin = i * cfg->nvertex / NTHREADS;
+		out[i].end = (i + 1) * cfg->nvertex / NTHREADS;
+	}
+
+	run(workers(), output, out, sizeof out[0]);
+
+	for (i = 0; i < NTHREADS; ++i) {
+		if (fwrite(out[i].buf, 1, out[i].size, fp) != out[i].size)
+			syserror(errno, "cannot print sets");
+		free(out[i].buf);
+	}
+}
+
+/* range_t: the vertices one thread hashes for verify. */
+typedef struct {
+	cfg_t*          cfg;
+	size_t          begin;
+	size_t          end;
+	uint64_t*       hash;
+} range_t;
+
+static void* hash_range(void* arg)
+{
+	range_t*        range = arg;
+	vertex_t*       u;
+	size_t          i;
+
+	for (i = range->begin; i < range->end; ++i) {
+		u = &range->cfg->vertex[i];
+		range->hash[i] = hash_set(u->set[OUT], hash_set(u->set[IN], i));
+	}
+
+	return NULL;
+}
+
+/* hashes: one hash of IN and OUT per vertex, computed in parallel. */
+static uint64_t* hashes(cfg_t* cfg)
+{
+	range_t         range[NTHREADS];
+	uint64_t*       hash;
+	size_t          i;
+
+	hash = malloc(cfg->nvertex * sizeof hash[0]);
+	if (hash == NULL && cfg->nvertex > 0)
+		error("out of memory");
+
+	for (i = 0; i < NTHREADS; ++i) {
+		range[i].cfg = cfg;
+		range[i].begin = i * cfg->nvertex / NTHREADS;
+		range[i].end = (i + 1) * cfg->nvertex / NTHREADS;
+		range[i].hash = hash;
+	}
+
+	run(workers(), hash_range, range, sizeof range[0]);
+
+	return hash;
+}
+
+/* verify: solve the last problem again with the sequential solver and
+ * compare the hashes of the sets before and after. the sequential
+ * solution is left in cfg, and a later liveness() stays incremental. */
+size_t verify(cfg_t* cfg)
+{
+	uint64_t*       found;
+	uint64_t*       expect;
+	queue_t*        worklist;
+	solver_t        solver;
+	size_t          ndiff;
+	size_t          i;
+
+	found = hashes(cfg);
+
+	worklist = q_new();
+	restart(cfg, cfg->problem, worklist);
+	solver = cfg->solver;
+	cfg->solver = SEQUENTIAL;
+	solve(cfg, worklist);
+	cfg->solver = solver;
+	q_free(worklist);
+
+	expect = hashes(cfg);
+
+	ndiff = 0;
+	for (i = 0; i < cfg->nvertex; ++i)
+		if (found[i] != expect[i])
+			ndiff += 1;
+
+	free(found);
+	free(expect);
+
+	return ndiff;
+}
+
+void set_stats(cfg_t* cfg, bool enable)
+{
+	size_t          i;
+
+	if (enable && cfg->stats == NULL) {
+		cfg->stats = calloc(NTHREADS, sizeof cfg->stats[0]);
+		cfg->visits = calloc(cfg->nvertex, sizeof cfg->visits[0]);
+		if (cfg->stats == NULL || (cfg->visits == NULL && cfg->nvertex > 0))
+			error("out of memory");
+	} else if (!enable && cfg->stats != NULL) {
+		for (i = 0; i < NTHREADS; ++i)
+			free(cfg->stats[i].sample);
+		free(cfg->stats);
+		free(cfg->visits);
+		cfg->stats = NULL;
+		cfg->visits = NULL;
+	}
+}
+
+/* print_stats: visits[k] is the number of vertices processed k times
+ * by the last solve. rounds is the number of JACOBI rounds, and for
+ * the other solvers the most times any vertex was processed. */
+void print_stats(cfg_t* cfg, FILE* fp)
+{
+	stats_t*        stats;
+	size_t*         visits;
+	size_t          rounds;
+	size_t          i;
+	size_t          j;
+
+	if (cfg->stats == NULL)
+		error("stats are not enabled");
+
+	rounds = 0;
+	for (i = 0; i < cfg->nvertex; ++i)
+		if (cfg->visits[i] > rounds)
+			rounds = cfg->visits[i];
+
+	visits = calloc(rounds + 1, sizeof visits[0]);
+	if (visits == NULL)
+		error("out of memory");
+
+	for (i = 0; i < cfg->nvertex; ++i)
+		visits[cfg->visits[i]] += 1;
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"solver\": \"%s\",\n", solver_name[cfg->used]);
+	fprintf(fp, "  \"nvertex\": %zu,\n", cfg->nvertex);
+	fprintf(fp, "  \"nsymbol\": %zu,\n", cfg->nsymbol);
+	fprintf(fp, "  \"nthread\": %d,\n", NTHREADS);
+	fprintf(fp, "  \"pages\": \"%s\",\n", pages_name(cfg->got));
+	fprintf(fp, "  \"time\": %.6f,\n", cfg->time);
+	fprintf(fp, "  \"rounds\": %zu,\n", cfg->used == JACOBI ? cfg->rounds : rounds);
+
+	fprintf(fp, "  \"visits\": [");
+	for (i = 0; i <= rounds; ++i)
+		fprintf(fp, "%s%zu", i == 0 ? "" : ", ", visits[i]);
+	fprintf(fp, "],\n");
+
+	fprintf(fp, "  \"threads\": [\n");
+	for (i = 0; i < NTHREADS; ++i) {
+		stats = &cfg->stats[i];
+		fprintf(fp, "    {\n");
+		fprintf(fp, "      \"processed\": %zu,\n", stats->processed);
+		fprintf(fp, "      \"changed\": %zu,\n", stats->changed);
+		fprintf(fp, "      \"cas_failed\": %zu,\n", stats->casfail);
+		fprintf(fp, "      \"contended\": %zu,\n", stats->contended);
+		fprintf(fp, "      \"wait\": %.6f,\n", stats->wait);
+		fprintf(fp, "      \"queue\": [");
+		for (j = 0; j < stats->nsample; ++j)
+			fprintf(fp, "%s[%.6f, %zu]", j == 0 ? "" : ", ",
+				stats->sample[j].time, stats->sample[j].length);
+		fprintf(fp, "]\n");
+		fprintf(fp, "    }%s\n", i + 1 < NTHREADS ? "," : "");
+	}
+	fprintf(fp, "  ]\n");
+	fprintf(fp, "}\n");
+
+	free(visits);
 }
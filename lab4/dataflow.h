@@ -15,14 +15,107 @@ typedef enum {
 	NSETS
 } set_type_t;
 
+typedef enum {
+	WORKLIST,	/* recompute OUT from every successor IN	*/
+	DELTA,		/* push only newly added IN bits to preds	*/
+	SCC,		/* strongly connected components, sinks first	*/
+	PARTITION,	/* one region per thread, deltas across cuts	*/
+	JACOBI,		/* parallel rounds over the dirty vertices	*/
+	SLICED,		/* every vertex, one slice of symbols per thread */
+	MONOTONE,	/* WORKLIST growing sets by fetch_or, union only */
+	SEQUENTIAL,	/* round robin in one thread, for verify()	*/
+	AUTO,		/* SLICED for wide sets, WORKLIST otherwise	*/
+	NSOLVERS
+} solver_t;
+
+typedef enum {
+	BACKWARD,	/* from successors, like liveness		*/
+	FORWARD		/* from predecessors				*/
+} direction_t;
+
+typedef enum {
+	UNION,		/* may problems					*/
+	INTERSECTION	/* must problems				*/
+} meet_t;
+
+/* problem_t: a gen/kill problem where USE holds gen and DEF kill. the
+ * set flowing along the direction is IN = USE | (OUT - DEF) backwards
+ * and OUT = USE | (IN - DEF) forwards. a vertex without successors
+ * (backwards) or predecessors (forwards) meets the empty set. */
+typedef struct {
+	direction_t	direction;
+	meet_t		meet;
+} problem_t;
+
+typedef enum {
+	BASE,		/* the normal pages of malloc			*/
+	TRANSPARENT,	/* madvise(MADV_HUGEPAGE) on aligned 2 MB	*/
+	HUGETLB,	/* MAP_HUGETLB from the reserved pool		*/
+	NPAGES
+} pages_t;
+
 cfg_t*	new_cfg(size_t nvertex, size_t nsymbol, size_t max_succ);
 void	free_cfg(cfg_t*);
 
+/* set_pages: the pages backing the set slabs of the cfgs allocated
+ * from now on. got_pages is the smallest kind one cfg obtained. */
+void		set_pages(pages_t);
+pages_t		got_pages(cfg_t*);
+pages_t		find_pages(const char* name);
+const char*	pages_name(pages_t);
+
+typedef enum {
+	DOT,		/* graphviz digraph				*/
+	EDGES,		/* one "pred succ" line per edge		*/
+	BINARY		/* store_cfg() format				*/
+} format_t;
+
+/* the binary format is mapped, so loading only builds the edges. */
+cfg_t*	load_cfg(const char* name);
+
+/* import_cfg: a cfg with the edges of an EDGES file, e.g. one captured
+ * from a compiler, and empty USE and DEF sets of nsymbol symbols. it
+ * has as many vertices as the largest index in the file needs. */
+cfg_t*	import_cfg(const char* name, size_t nsymbol);
+size_t	nvertices(cfg_t*);
+void	store_cfg(cfg_t*, const char* name);
+void	export_cfg(cfg_t*, const char* name, format_t);
+
 void 	connect(cfg_t* cfg, size_t pred, size_t succ);
+void	disconnect(cfg_t* cfg, size_t pred, size_t succ);
+
+/* after the first call, liveness() only re-solves from the vertices
+ * affected by connect, disconnect, setbit and resetbit since then. only
+ * WORKLIST, DELTA and MONOTONE do that by themselves. SCC, PARTITION,
+ * JACOBI and SLICED set up over the whole cfg on every solve, so such a
+ * re-solve uses the WORKLIST solver instead. */
 void	liveness(cfg_t*);
 
+/* liveness_batch: liveness() of many small cfgs, each solved by one
+ * thread of the team the solvers share. */
+void	liveness_batch(cfg_t**, size_t);
+
+/* dataflow: solve any problem_t with the worklist, sliced or sequential
+ * solver, or the monotone one for a union problem. */
+void	dataflow(cfg_t*, problem_t);
+
+/* verify: the number of vertices whose IN or OUT differs from what
+ * the SEQUENTIAL solver finds for the last solved problem. */
+size_t	verify(cfg_t*);
+
+/* set_solver: AUTO picks SLICED when every thread gets at least one
+ * slice of the symbols, and is the default of a new cfg. */
+void		set_solver(cfg_t*, solver_t);
+solver_t	find_solver(const char* name);
+
 bool	testbit(cfg_t*, size_t vertex, set_type_t type, size_t index);
 void	setbit(cfg_t*, size_t vertex, set_type_t type, size_t index);
+void	resetbit(cfg_t*, size_t vertex, set_type_t type, size_t index);
 void	print_sets(cfg_t*, FILE*);
 
+/* with stats enabled every solve records what each thread did, which
+ * print_stats() writes as JSON. */
+void	set_stats(cfg_t*, bool);
+void	print_stats(cfg_t*, FILE*);
+
 #endif
@@ -4,15 +4,44 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <inttypes.h>
+#include <errno.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/time.h>
 #include "dataflow.h"
-#include "list.h"
 #include "error.h"
 #include "random.h"
 
 char*	progname;
 
+static const struct {
+	const char*	name;
+	problem_t	problem;
+} problems[] = {
+	{ "live",	{ BACKWARD,	UNION } },
+	{ "reach",	{ FORWARD,	UNION } },
+	{ "avail",	{ FORWARD,	INTERSECTION } },
+	{ "busy",	{ BACKWARD,	INTERSECTION } },
+};
+
+#define LOOP	16	/* vertices in each loop of LOOPS */
+
+/* shape_t: how generate_cfg chooses the successors. */
+typedef enum {
+	RANDOM,		/* 0 -> 1, 2 and random successors		*/
+	CHAIN,		/* i -> i + 1					*/
+	LOOPS,		/* a chain of loops of LOOP vertices		*/
+	NEST,		/* a chain where i -> n - 1 - i in the 2nd half	*/
+	NSHAPES
+} shape_t;
+
+static const char* shapes[NSHAPES] = {
+	[RANDOM]	= "random",
+	[CHAIN]		= "chain",
+	[LOOPS]		= "loops",
+	[NEST]		= "nest",
+};
+
 static double sec(void)
 {
 	struct timeval	tv;
@@ -22,64 +51,149 @@ static double sec(void)
 	return tv.tv_sec + 1e-6 * tv.tv_usec;
 }
 
-static void generate_cfg(cfg_t* cfg, size_t n, int max_succ)
+/* generate_t: the vertices one thread generates. vertex i uses stream
+ * i of the seed, with the successors first and then the usedefs, so the
+ * graph does not depend on the number of threads. the shapes other
+ * than RANDOM only use the stream for the usedefs, and an imported cfg
+ * already has its edges, so succ is NULL. */
+typedef struct {
+	cfg_t*		cfg;
+	uint64_t	seed;
+	size_t		begin;
+	size_t		end;
+	size_t		n;
+	size_t		nsym;
+	size_t		nactive;
+	size_t		max_succ;
+	shape_t		shape;
+	size_t*		nsucc;
+	size_t*		succ;
+} generate_t;
+
+/* successors: the successors of vertex i, as draws 0 up to max_succ
+ * of its stream. */
+static void successors(generate_t* g, size_t i)
 {
-	int		i;
-	int		j;
-	int		k;
-	int		s;
-	FILE*		fp;
-	const char*	name = "cfg.dot";
+	size_t		j;
+	size_t		k;
+	size_t*		succ;
 
-	fp = fopen(name, "w");
+	k = 0;
 
-	if (fp == NULL)
-		error("cannot open \"%s\" for writing", name);
+	if (g->shape != RANDOM) {
+		succ = &g->succ[i * g->max_succ];
+		g->nsucc[i] = 0;
 
-	fprintf(fp, "digraph cfg {\n");
-	fprintf(fp, "0 -> { 1 2 }\n");
+		if (i + 1 < g->n)
+			succ[g->nsucc[i]++] = i + 1;
 
-	connect(cfg, 0, 1);
-	connect(cfg, 0, 2);
+		if (g->shape == LOOPS && i % LOOP == LOOP - 1)
+			succ[g->nsucc[i]++] = i + 1 - LOOP;
+		else if (g->shape == NEST && 2 * i >= g->n)
+			succ[g->nsucc[i]++] = g->n - 1 - i;
+	} else if (i == 0) {
+		g->nsucc[i] = 2;
+		g->succ[0] = 1;
+		g->succ[1] = 2;
+	} else if (i == 1)
+		g->nsucc[i] = 0;
+	else {
+		g->nsucc[i] = 1 + random_at(g->seed, i, k++) % g->max_succ;
+		for (j = 0; j < g->nsucc[i]; ++j)
+			g->succ[i * g->max_succ + j] = random_at(g->seed, i, k++) % g->n;
+	}
+}
 
-	for (i = 2; i < n; ++i) {
-		
-		s = next() % max_succ;
-		s += 1;
-		
-		for (j = 0; j < s; ++j) {
-			k = abs(next()) % n;
-			
-			connect(cfg, i, k);
-			fprintf(fp, "%d -> { %d }\n", i, k);
+static void* generate(void* arg)
+{
+	generate_t*	g = arg;
+	size_t		i;
+	size_t		j;
+	size_t		k;
+	size_t		sym;
+
+	for (i = g->begin; i < g->end; ++i) {
+		if (g->succ != NULL)
+			successors(g, i);
+
+		k = g->max_succ + 1;
+
+		for (j = 0; j < g->nactive; ++j) {
+			sym = random_at(g->seed, i, k++) % g->nsym;
+
+			if (j % 4 != 0) {
+				if (!testbit(g->cfg, i, DEF, sym))
+					setbit(g->cfg, i, USE, sym);
+			} else if (!testbit(g->cfg, i, USE, sym))
+				setbit(g->cfg, i, DEF, sym);
 		}
 	}
 
-	fprintf(fp, "}\n");
-	fclose(fp);
+	return NULL;
 }
 
-static void generate_usedefs(
+/* generate_cfg: the usedefs and successors of each vertex are generated
+ * in parallel, but connect() must add the edges one at a time. without
+ * edges only the usedefs are generated. */
+static void generate_cfg(
 	cfg_t*		cfg,
 	size_t		n,
 	size_t		nsym,
-	size_t		nactive)
+	size_t		max_succ,
+	size_t		nactive,
+	size_t		nthread,
+	shape_t		shape,
+	uint64_t	seed,
+	bool		edges)
 {
+	generate_t*	g;
+	pthread_t*	thread;
+	size_t*		nsucc;
+	size_t*		succ;
 	size_t		i;
 	size_t		j;
-	size_t		sym;
+	int		err;
 
-	for (i = 0; i < n; ++i) {
-		for (j = 0; j < nactive; ++j) {
-			sym = abs(next()) % nsym;
+	g = calloc(nthread, sizeof g[0]);
+	thread = calloc(nthread, sizeof thread[0]);
+	nsucc = edges ? calloc(n, sizeof nsucc[0]) : NULL;
+	succ = edges ? calloc(n * max_succ, sizeof succ[0]) : NULL;
 
-			if (j % 4 != 0) {
-				if (!testbit(cfg, i, DEF, sym))
-					setbit(cfg, i, USE, sym);
-			} else if (!testbit(cfg, i, USE, sym))
-				setbit(cfg, i, DEF, sym);
-		}
+	if (g == NULL || thread == NULL || (edges && (nsucc == NULL || succ == NULL)))
+		error("out of memory");
+
+	for (i = 0; i < nthread; ++i) {
+		g[i].cfg	= cfg;
+		g[i].seed	= seed;
+		g[i].begin	= i * n / nthread;
+		g[i].end	= (i + 1) * n / nthread;
+		g[i].n		= n;
+		g[i].nsym	= nsym;
+		g[i].nactive	= nactive;
+		g[i].max_succ	= max_succ;
+		g[i].shape	= shape;
+		g[i].nsucc	= nsucc;
+		g[i].succ	= succ;
+
+		err = pthread_create(&thread[i], NULL, generate, &g[i]);
+		if (err)
+			syserror(err, "cannot create thread");
+	}
+
+	for (i = 0; i < nthread; ++i) {
+		err = pthread_join(thread[i], NULL);
+		if (err)
+			syserror(err, "cannot join thread");
 	}
+
+	for (i = 0; edges && i < n; ++i)
+		for (j = 0; j < nsucc[i]; ++j)
+			connect(cfg, i, succ[i * max_succ + j]);
+
+	free(g);
+	free(thread);
+	free(nsucc);
+	free(succ);
 }
 
 int main(int argc, char** argv) 
@@ -90,55 +204,242 @@ int main(int argc, char** argv)
 	size_t		nactive;
 	size_t		n;
 	size_t		max_succ;
+	size_t		nthread;
 	cfg_t*		cfg;
+	cfg_t**		cfgs;
+	size_t		ncfg;
+	size_t		nbatch = 0;
+	size_t		k;
 	bool		print;
+	bool		check = false;
+	size_t		ndiff;
 	int		seed = 1;
+	int		c;
+	solver_t	solver = AUTO;
+	shape_t		shape = RANDOM;
+	size_t		problem = 0;
+	const char*	input = NULL;
+	const char*	import = NULL;
+	const char*	stats = NULL;
+	pages_t		pages = BASE;
+	FILE*		fp;
+	const char*	output[BINARY + 1] = { NULL };
+	format_t	format;
 
 	progname	= argv[0];
 
+	while ((c = getopt(argc, argv, "b:d:e:g:i:j:m:p:r:s:vw:")) != -1) {
+		switch (c) {
+		case 'b':
+			nbatch = atoi(optarg);
+			break;
+
+		case 'd':
+			output[DOT] = optarg;
+			break;
+
+		case 'e':
+			output[EDGES] = optarg;
+			break;
+
+		case 'g':
+			for (shape = 0; shape < NSHAPES; ++shape)
+				if (strcmp(optarg, shapes[shape]) == 0)
+					break;
+			if (shape == NSHAPES)
+				error("unknown shape \"%s\"", optarg);
+			break;
+
+		case 'i':
+			import = optarg;
+			break;
+
+		case 'j':
+			stats = optarg;
+			break;
+
+		case 'm':
+			pages = find_pages(optarg);
+			if (pages == NPAGES)
+				error("unknown pages \"%s\"", optarg);
+			break;
+
+		case 'r':
+			input = optarg;
+			break;
+
+		case 'v':
+			check = true;
+			break;
+
+		case 'w':
+			output[BINARY] = optarg;
+			break;
+
+		case 'p':
+			for (problem = 0; problem < sizeof problems / sizeof problems[0]; ++problem)
+				if (strcmp(optarg, problems[problem].name) == 0)
+					break;
+			if (problem == sizeof problems / sizeof problems[0])
+				error("unknown problem \"%s\"", optarg);
+			break;
+
+		case 's':
+			solver = find_solver(optarg);
+			if (solver == NSOLVERS)
+				error("unknown solver \"%s\"", optarg);
+			break;
+
+		default:
+			error("usage: %s [-b batch] [-g shape] [-m pages] [-p problem] [-s solver] [-v] [-r cfg] [-i edges] [-w cfg] [-d dot] [-e edges] [-j stats] [nsym n max-succ nactive nthread print]", progname);
+		}
+	}
+
+	argv += optind - 1;
+	argc -= optind - 1;
+
 	if (argc == 7) {
 		nsym	 	= atoi(argv[1]);
 		n		= atoi(argv[2]);
 		max_succ	= atoi(argv[3]);
 		nactive	 	= atoi(argv[4]);
+		nthread	 	= atoi(argv[5]);
 		print	 	= atoi(argv[6]);
 	} else {
 		nsym	 	= 100;
 		n		= 10;
 		max_succ	= 4;
 		nactive	 	= 10;
+		nthread		= 4;
 		print		= 1;
 	}
 
-	printf("nsymbol   = %zu\n", nsym);
-	printf("nvertex   = %zu\n", n);
-	printf("max-succ  = %zu\n", max_succ);
-	printf("nactive   = %zu\n", nactive);
+	if (nthread < 1)
+		nthread = 1;
+
+	if (input != NULL && import != NULL)
+		error("a cfg is either read or imported");
+
+	/* a batch is of that many cfgs of the same size. */
+	if (nbatch > 0 && problem != 0)
+		error("a batch can only be solved for liveness");
+
+	if (nbatch > 0 && stats != NULL)
+		error("a batch does not record stats");
+
+	set_pages(pages);
+
+	ncfg = nbatch > 0 ? nbatch : 1;
+	cfgs = calloc(ncfg, sizeof cfgs[0]);
+	if (cfgs == NULL)
+		error("out of memory");
+
+	if (input != NULL) {
+		printf("reading %s...\n", input);
+		begin = sec();
+		for (k = 0; k < ncfg; ++k)
+			cfgs[k] = load_cfg(input);
+		end = sec();
+		printf("R = %8.4lf s\n", end-begin);
+	} else if (import != NULL) {
+		/* the usedefs of an imported cfg are generated as usual. */
+		printf("importing %s...\n", import);
+		begin = sec();
+		for (k = 0; k < ncfg; ++k) {
+			cfgs[k] = import_cfg(import, nsym);
+			n = nvertices(cfgs[k]);
+			generate_cfg(cfgs[k], n, nsym, max_succ, nactive, nthread, shape, seed + k, false);
+		}
+		end = sec();
+		printf("nvertex   = %zu\n", n);
+		printf("I = %8.4lf s\n", end-begin);
+	} else {
+		printf("nsymbol   = %zu\n", nsym);
+		printf("nvertex   = %zu\n", n);
+		printf("max-succ  = %zu\n", max_succ);
+		printf("nactive   = %zu\n", nactive);
+		printf("shape     = %s\n", shapes[shape]);
 	
-	if (seed == 1)
-		init_random(seed);
-	else {
-		printf("pid %d\n", getpid());
-		init_random(getpid());
+		if (seed != 1) {
+			seed = getpid();
+			printf("pid %d\n", seed);
+		}
+
+		if (shape != RANDOM && max_succ < 2)
+			error("the %s shape needs two successors", shapes[shape]);
+
+		/* vertex 0 of a random cfg always branches to 1 and 2. */
+		if (shape == RANDOM && (n < 3 || max_succ < 2))
+			error("the %s shape needs three vertices and two successors", shapes[shape]);
+
+		printf("generating cfg and usedefs...\n");
+		begin = sec();
+		for (k = 0; k < ncfg; ++k) {
+			cfgs[k] = new_cfg(n, nsym, max_succ);
+			generate_cfg(cfgs[k], n, nsym, max_succ, nactive, nthread, shape, seed + k, true);
+		}
+		end = sec();
+		printf("G = %8.4lf s\n", end-begin);
 	}
 
-	printf("generating cfg...\n");
-	cfg = new_cfg(n, nsym, max_succ);
-	generate_cfg(cfg, n, max_succ);
+	for (k = 0; k < ncfg; ++k)
+		set_solver(cfgs[k], solver);
 
-	printf("generating usedefs...\n");
-	generate_usedefs(cfg, n, nsym, nactive);
+	cfg = cfgs[0];
+	set_stats(cfg, stats != NULL);
 
-	printf("liveness...\n\n");
+	if (pages != BASE)
+		printf("pages     = %s\n", pages_name(got_pages(cfg)));
+
+	for (format = DOT; format <= BINARY; format += 1)
+		if (output[format] != NULL) {
+			printf("writing %s...\n", output[format]);
+			export_cfg(cfg, output[format], format);
+		}
+
+	printf("%s...\n\n", problem == 0 ? "liveness" : problems[problem].name);
 	begin = sec();
-	liveness(cfg);
+	if (nbatch > 0)
+		liveness_batch(cfgs, nbatch);
+	else if (problem == 0)
+		liveness(cfg);
+	else
+		dataflow(cfg, problems[problem].problem);
 	end = sec();
 
 	printf("T = %8.4lf s\n\n", end-begin);
 
-	if (print)
-		print_sets(cfg, stdout);
+	if (nbatch > 0)
+		printf("%.1lf cfgs/s\n\n", nbatch / (end-begin));
+
+	if (stats != NULL) {
+		fp = fopen(stats, "w");
+		if (fp == NULL)
+			syserror(errno, "cannot open \"%s\" for writing", stats);
+		print_stats(cfg, fp);
+		if (fclose(fp) != 0)
+			syserror(errno, "cannot write \"%s\"", stats);
+	}
+
+	/* verify only prints the time, since the sets are not changed if
+	 * they were right. */
+	if (check) {
+		begin = sec();
+		ndiff = 0;
+		for (k = 0; k < ncfg; ++k)
+			ndiff += verify(cfgs[k]);
+		end = sec();
+		printf("V = %8.4lf s\n\n", end-begin);
+		if (ndiff != 0)
+			error("%zu vertices differ from the sequential solution", ndiff);
+	}
+
+	for (k = 0; k < ncfg; ++k) {
+		if (print)
+			print_sets(cfgs[k], stdout);
+		free_cfg(cfgs[k]);
+	}
 
-	free_cfg(cfg);
+	free(cfgs);
 	return 0;
 }
@@ -0,0 +1,117 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "pages.h"
+#include "error.h"
+
+#define LINESIZE	64
+#define HUGESIZE	(2 * 1024 * 1024)
+
+static const char* pages_names[NPAGES] = {
+	[BASE]		= "base",
+	[TRANSPARENT]	= "transparent",
+	[HUGETLB]	= "hugetlb",
+};
+
+pages_t find_pages(const char* name)
+{
+	pages_t		p;
+
+	for (p = 0; p < NPAGES; p += 1)
+		if (strcmp(name, pages_names[p]) == 0)
+			break;
+
+	return p;
+}
+
+const char* pages_name(pages_t pages)
+{
+	return pages_names[pages];
+}
+
+/* huge: size rounded up to whole huge pages. */
+static size_t huge(size_t size)
+{
+	return (size + HUGESIZE - 1) / HUGESIZE * HUGESIZE;
+}
+
+/* thp: whether the kernel hands out transparent huge pages to a range
+ * given MADV_HUGEPAGE. madvise succeeds even when they are disabled, so
+ * the mode the kernel shows in brackets is read instead. */
+static bool thp(void)
+{
+	FILE*		fp;
+	char		mode[64];
+	bool		on;
+
+	fp = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+	if (fp == NULL)
+		return false;
+
+	on = fgets(mode, sizeof mode, fp) != NULL && strstr(mode, "[never]") == NULL;
+	fclose(fp);
+
+	return on;
+}
+
+/* transparent: map one huge page more than needed and unmap the ends,
+ * so the kernel can back the whole range with aligned huge pages. if
+ * madvise fails or the kernel has them disabled the range stays with
+ * base pages. */
+static void* transparent(size_t size, pages_t* got)
+{
+	char*		p;
+	char*		q;
+	size_t		n;
+
+	n = huge(size);
+	p = mmap(NULL, n + HUGESIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED)
+		syserror(errno, "cannot map %zu bytes", n);
+
+	q = (char*)(((uintptr_t)p + HUGESIZE - 1) / HUGESIZE * HUGESIZE);
+	if (q > p)
+		munmap(p, q - p);
+	munmap(q + n, p + HUGESIZE - q);
+
+	*got = madvise(q, n, MADV_HUGEPAGE) == 0 && thp() ? TRANSPARENT : BASE;
+
+	return q;
+}
+
+void* alloc_pages(size_t size, pages_t want, pages_t* got)
+{
+	void*		p;
+
+	if (want == BASE || size == 0) {
+		*got = BASE;
+		p = aligned_alloc(LINESIZE, (size + LINESIZE - 1) / LINESIZE * LINESIZE);
+		if (p == NULL && size > 0)
+			error("out of memory");
+		return p;
+	}
+
+	if (want == HUGETLB) {
+		p = mmap(NULL, huge(size), PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p != MAP_FAILED) {
+			*got = HUGETLB;
+			return p;
+		}
+	}
+
+	return transparent(size, got);
+}
+
+void free_pages(void* p, size_t size, pages_t want)
+{
+	if (want == BASE || size == 0)
+		free(p);
+	else if (p != NULL && munmap(p, huge(size)) != 0)
+		syserror(errno, "munmap failed");
+}
@@ -0,0 +1,14 @@
+#ifndef pages_h
+#define pages_h
+
+#include <stddef.h>
+#include "dataflow.h"
+
+/* alloc_pages: size bytes aligned to a cache line, backed by the pages
+ * asked for if the kernel gives them and otherwise by the next smaller
+ * kind, which is stored in got. free_pages needs the same size and the
+ * kind that was asked for. */
+void*	alloc_pages(size_t size, pages_t want, pages_t* got);
+void	free_pages(void* p, size_t size, pages_t want);
+
+#endif
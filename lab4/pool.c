@@ -0,0 +1,88 @@
+#include <stdlib.h>
+#include "pool.h"
+#include "error.h"
+
+#define SLABSIZE	(64 * 1024)
+
+/* node_t: a free node, or the header of a slab. */
+typedef struct node_t	node_t;
+
+struct node_t {
+	node_t*		next;
+};
+
+struct pool_t {
+	size_t		size;	/* node size, a multiple of a pointer.	*/
+	node_t*		free;	/* freed nodes.				*/
+	node_t*		slab;	/* slabs, to free them all at once.	*/
+	char*		next;	/* next unused node in the first slab.	*/
+	char*		end;	/* end of the first slab.		*/
+};
+
+pool_t* new_pool(size_t size)
+{
+	pool_t*		pool;
+
+	pool = calloc(1, sizeof(pool_t));
+	if (pool == NULL)
+		error("out of memory");
+
+	if (size < sizeof(node_t))
+		size = sizeof(node_t);
+
+	pool->size = (size + sizeof(node_t) - 1) / sizeof(node_t) * sizeof(node_t);
+
+	return pool;
+}
+
+void free_pool(pool_t* pool)
+{
+	node_t*		slab;
+	node_t*		next;
+
+	if (pool == NULL)
+		return;
+
+	for (slab = pool->slab; slab != NULL; slab = next) {
+		next = slab->next;
+		free(slab);
+	}
+
+	free(pool);
+}
+
+void* pool_alloc(pool_t* pool)
+{
+	node_t*		node;
+	node_t*		slab;
+
+	if (pool->free != NULL) {
+		node = pool->free;
+		pool->free = node->next;
+		return node;
+	}
+
+	if (pool->next + pool->size > pool->end) {
+		slab = malloc(SLABSIZE);
+		if (slab == NULL)
+			error("out of memory");
+
+		slab->next = pool->slab;
+		pool->slab = slab;
+		pool->next = (char*)(slab + 1);
+		pool->end = (char*)slab + SLABSIZE;
+	}
+
+	node = (node_t*)pool->next;
+	pool->next += pool->size;
+
+	return node;
+}
+
+void pool_free(pool_t* pool, void* p)
+{
+	node_t*		node = p;
+
+	node->next = pool->free;
+	pool->free = node;
+}
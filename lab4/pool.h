@@ -0,0 +1,17 @@
+#ifndef pool_h
+#define pool_h
+
+#include <stddef.h>
+
+typedef struct pool_t	pool_t;
+
+/* a pool hands out nodes of one size from large slabs and keeps freed
+ * nodes for reuse. it is not locked, so each thread needs its own, but
+ * a node may be freed to another pool of the same size than the one it
+ * came from as long as the pools are freed together. */
+pool_t*	new_pool(size_t size);
+void	free_pool(pool_t*);
+void*	pool_alloc(pool_t*);
+void	pool_free(pool_t*, void*);
+
+#endif
@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <inttypes.h>
+#include "random.h"
 
 static int	w = 1;
 static int	z = 2;
@@ -20,3 +22,20 @@ int next(void)
 
 	return x;
 }
+
+static uint64_t mix(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+	return z ^ (z >> 31);
+}
+
+/* random_at: the counter-th number of stream, computed directly with
+ * the splitmix64 finalizer, so that any range of streams can be
+ * generated by any thread in any order. */
+uint64_t random_at(uint64_t seed, uint64_t stream, uint64_t counter)
+{
+	return mix(mix(seed + 0x9e3779b97f4a7c15ULL * (stream + 1))
+		+ 0x9e3779b97f4a7c15ULL * (counter + 1));
+}
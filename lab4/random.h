@@ -1,2 +1,4 @@
+#include <inttypes.h>
 void init_random(int seed);
 int next(void);
+uint64_t random_at(uint64_t seed, uint64_t stream, uint64_t counter);
@@ -4,21 +4,66 @@
 #include <stdbool.h>
 #include <inttypes.h>
 #include <string.h>
+#include <stdatomic.h>
 #include "set.h"
 #include "error.h"
 
+/* words and summary words of a set of m elements. */
+#define WORDS(m)	(((m) + 63) / 64)
+
+/* summary word j of s. a set of one slice keeps it right after its
+ * words. with more slices each summary word gets a cache line of its
+ * own after the words, since the threads of the sliced solver write
+ * the summaries of different slices of one set at the same time. */
+#define SUMBASE(n)	((n) <= 64 ? (n) : ((n) + 7) / 8 * 8)
+#define SUMSTEP(n)	((n) <= 64 ? 1 : 8)
+#define SUMMARY(s, j)	((s)->a[SUMBASE((s)->n) + SUMSTEP((s)->n) * (j)])
+
+/* a word which other threads may merge into at the same time. */
+#define ATOMIC(p)	((_Atomic uint64_t*)(p))
+
+/* a word which other threads may read or write at the same time. */
+#define LOAD(p)		atomic_load_explicit(ATOMIC(p), memory_order_relaxed)
+#define STORE(p, x)	atomic_store_explicit(ATOMIC(p), (x), memory_order_relaxed)
+
+/* span: the words of s covered by summary word j. */
+static inline size_t span(set_t* s, size_t j)
+{
+	return s->n - 64 * j < 64 ? s->n - 64 * j : 64;
+}
+
+/* full: summary word j when all its words are non-zero. */
+static inline uint64_t full(set_t* s, size_t j)
+{
+	return span(s, j) == 64 ? ~0ULL : (1ULL << span(s, j)) - 1;
+}
+
+/* summarise: set summary word j of t to r. it is only written when
+ * it changes, so a thread which finds its slice unchanged leaves the
+ * line alone. */
+static inline void summarise(set_t* t, size_t j, uint64_t r)
+{
+	if (SUMMARY(t, j) != r)
+		SUMMARY(t, j) = r;
+}
+
+/* dense: every word under summary word j is non-zero, so the kernels
+ * visit them with a plain loop instead of one bit at a time. */
+static inline bool dense(set_t* s, size_t j, uint64_t m)
+{
+	return m == full(s, j);
+}
+
 set_t* new_set(size_t m)
 {
 	set_t*	s;
-	size_t	n;
 
-	n = (m + 63) / 64;
-	s = calloc(1, sizeof(set_t) + n * sizeof(uint64_t));
+	s = calloc(1, set_size(m));
 
 	if (s == NULL)
 		error("out of memory");
 
-	s->n = n;
+	s->n = WORDS(m);
 
 	return s;
 }
@@ -28,35 +73,603 @@ void free_set(set_t* s)
 	free(s);
 }
 
+/* set_size: the bytes a set of m elements needs. */
+size_t set_size(size_t m)
+{
+	size_t	n = WORDS(m);
+
+	return sizeof(set_t) + (SUMBASE(n) + SUMSTEP(n) * WORDS(n)) * sizeof(uint64_t);
+}
+
+/* place_set: an empty set of m elements at p, which needs set_size(m)
+ * bytes. it is freed with the memory and not with free_set. */
+set_t* place_set(void* p, size_t m)
+{
+	set_t*	s = p;
+
+	memset(s, 0, set_size(m));
+	s->n = WORDS(m);
+
+	return s;
+}
+
+/* valid_set: s has the words of a set of m elements, no element from
+ * m up, and a summary bit for exactly the non-zero words. */
+bool valid_set(set_t* s, size_t m)
+{
+	size_t		i;
+	uint64_t	bit;
+
+	if (s->n != WORDS(m))
+		return false;
+
+	if (m % 64 != 0 && s->a[s->n - 1] >> (m % 64) != 0)
+		return false;
+
+	if (s->n % 64 != 0 && SUMMARY(s, s->n / 64) >> (s->n % 64) != 0)
+		return false;
+
+	for (i = 0; i < s->n; ++i) {
+		bit = SUMMARY(s, i / 64) >> (i % 64) & 1;
+		if (bit != (s->a[i] != 0))
+			return false;
+	}
+
+	return true;
+}
+
 void set(set_t* s, uint64_t a)
 {
 	s->a[a / 64] |= 1ULL << (a % 64);
+	SUMMARY(s, a / 4096) |= 1ULL << (a / 64 % 64);
+}
+
+void clear(set_t* s, uint64_t a)
+{
+	s->a[a / 64] &= ~(1ULL << (a % 64));
+	if (s->a[a / 64] == 0)
+		SUMMARY(s, a / 4096) &= ~(1ULL << (a / 64 % 64));
+}
+
+/* fill: s = { 0, 1, ..., m-1 }. */
+void fill(set_t* s, size_t m)
+{
+	fill_slice(s, m, 0, WORDS(s->n));
+}
+
+/* fill_slice: the elements below m in the words of summary words j0
+ * up to j1. */
+void fill_slice(set_t* s, size_t m, size_t j0, size_t j1)
+{
+	size_t	i;
+	size_t	j;
+	size_t	e;
+
+	for (j = j0; j < j1; ++j) {
+		for (i = 64 * j, e = i + span(s, j); i < e; ++i)
+			s->a[i] = ~0ULL;
+		summarise(s, j, full(s, j));
+	}
+
+	if (j0 < j1 && j1 == WORDS(s->n) && m % 64 != 0)
+		s->a[s->n - 1] = (1ULL << (m % 64)) - 1;
+}
+
+/* zero: clear the words of s in the bits of mask m of summary word j. */
+static void zero(set_t* s, size_t j, uint64_t m)
+{
+	for (; m != 0; m &= m - 1)
+		s->a[64 * j + __builtin_ctzll(m)] = 0;
 }
 
 void reset(set_t* s)
 {
-	memset(s->a, 0, s->n * sizeof s->a[0]);
+	reset_slice(s, 0, WORDS(s->n));
+}
+
+void reset_slice(set_t* s, size_t j0, size_t j1)
+{
+	size_t	j;
+
+	for (j = j0; j < j1; ++j) {
+		zero(s, j, SUMMARY(s, j));
+		summarise(s, j, 0);
+	}
+}
+
+/* hash_set: a hash of the elements of s, continued from h. */
+uint64_t hash_set(set_t* s, uint64_t h)
+{
+	size_t		i;
+	size_t		j;
+	uint64_t	m;
+
+	for (j = 0; j < WORDS(s->n); ++j)
+		for (m = SUMMARY(s, j); m != 0; m &= m - 1) {
+			i = 64 * j + __builtin_ctzll(m);
+			h = (h ^ i ^ s->a[i]) * 0x9e3779b97f4a7c15ULL;
+			h ^= h >> 29;
+		}
+
+	return h;
 }
 
 bool equal(set_t* a, set_t* b)
 {
-	return memcmp(a->a, b->a, a->n * sizeof a->a[0]) == 0;
+	size_t		i;
+	size_t		j;
+	uint64_t	m;
+
+	for (j = 0; j < WORDS(a->n); ++j)
+		if (SUMMARY(a, j) != SUMMARY(b, j))
+			return false;
+
+	for (j = 0; j < WORDS(a->n); ++j)
+		for (m = SUMMARY(a, j); m != 0; m &= m - 1) {
+			i = 64 * j + __builtin_ctzll(m);
+			if (a->a[i] != b->a[i])
+				return false;
+		}
+
+	return true;
 }
 
+/* or, and and minus: t may be a or b. the words of t outside the
+ * words the result can have are cleared first. */
 void or(set_t* t, set_t* a, set_t* b)
 {
-	size_t	i;
+	or_slice(t, a, b, 0, WORDS(t->n));
+}
+
+void or_slice(set_t* t, set_t* a, set_t* b, size_t j0, size_t j1)
+{
+	size_t		i;
+	size_t		j;
+	size_t		e;
+	uint64_t	m;
+	uint64_t	w;
 
-	for (i = 0; i < t->n; ++i)
-		t->a[i] = a->a[i] | b->a[i];
+	for (j = j0; j < j1; ++j) {
+		m = SUMMARY(a, j) | SUMMARY(b, j);
+		zero(t, j, SUMMARY(t, j) & ~m);
+		summarise(t, j, m);
+		if (dense(t, j, m))
+			for (i = 64 * j, e = i + span(t, j); i < e; ++i)
+				t->a[i] = a->a[i] | b->a[i];
+		else for (w = m; w != 0; w &= w - 1) {
+			i = 64 * j + __builtin_ctzll(w);
+			t->a[i] = a->a[i] | b->a[i];
+		}
+	}
 }
 
-void propagate(set_t* in, set_t* out, set_t* def, set_t* use)
+void and(set_t* t, set_t* a, set_t* b)
 {
-	size_t	i;
+	and_slice(t, a, b, 0, WORDS(t->n));
+}
+
+void and_slice(set_t* t, set_t* a, set_t* b, size_t j0, size_t j1)
+{
+	size_t		i;
+	size_t		j;
+	size_t		e;
+	size_t		k;
+	uint64_t	m;
+	uint64_t	w;
+	uint64_t	r;
+
+	for (j = j0; j < j1; ++j) {
+		m = SUMMARY(a, j) & SUMMARY(b, j);
+		zero(t, j, SUMMARY(t, j) & ~m);
+		r = 0;
+		if (dense(t, j, m))
+			for (k = 0, e = span(t, j); k < e; ++k) {
+				i = 64 * j + k;
+				t->a[i] = a->a[i] & b->a[i];
+				r |= (uint64_t)(t->a[i] != 0) << k;
+			}
+		else for (w = m; w != 0; w &= w - 1) {
+			i = 64 * j + __builtin_ctzll(w);
+			t->a[i] = a->a[i] & b->a[i];
+			if (t->a[i] != 0)
+				r |= w & -w;
+		}
+		summarise(t, j, r);
+	}
+}
+
+/* minus: t = a - b. */
+void minus(set_t* t, set_t* a, set_t* b)
+{
+	size_t		i;
+	size_t		j;
+	size_t		e;
+	size_t		k;
+	uint64_t	m;
+	uint64_t	w;
+	uint64_t	r;
+
+	for (j = 0; j < WORDS(t->n); ++j) {
+		m = SUMMARY(a, j);
+		zero(t, j, SUMMARY(t, j) & ~m);
+		r = 0;
+		if (dense(t, j, m))
+			for (k = 0, e = span(t, j); k < e; ++k) {
+				i = 64 * j + k;
+				t->a[i] = a->a[i] & ~b->a[i];
+				r |= (uint64_t)(t->a[i] != 0) << k;
+			}
+		else for (w = m; w != 0; w &= w - 1) {
+			i = 64 * j + __builtin_ctzll(w);
+			t->a[i] = a->a[i] & ~b->a[i];
+			if (t->a[i] != 0)
+				r |= w & -w;
+		}
+		summarise(t, j, r);
+	}
+}
+
+bool overlap(set_t* a, set_t* b)
+{
+	size_t		i;
+	size_t		j;
+	uint64_t	m;
+
+	for (j = 0; j < WORDS(a->n); ++j)
+		for (m = SUMMARY(a, j) & SUMMARY(b, j); m != 0; m &= m - 1) {
+			i = 64 * j + __builtin_ctzll(m);
+			if (a->a[i] & b->a[i])
+				return true;
+		}
+
+	return false;
+}
+
+/* propagate: in = use | (out - def), returns true if in changed. only
+ * the words of out and use can be non-zero in the new in. */
+bool propagate(set_t* in, set_t* out, set_t* def, set_t* use)
+{
+	return propagate_slice(in, out, def, use, 0, WORDS(in->n));
+}
+
+bool propagate_slice(set_t* in, set_t* out, set_t* def, set_t* use, size_t j0, size_t j1)
+{
+	size_t		i;
+	size_t		j;
+	size_t		e;
+	size_t		k;
+	uint64_t	m;
+	uint64_t	w;
+	uint64_t	x;
+	uint64_t	r;
+	uint64_t	changed;
+
+	changed = 0;
+
+	for (j = j0; j < j1; ++j) {
+		m = SUMMARY(out, j) | SUMMARY(use, j);
+		changed |= SUMMARY(in, j) & ~m;
+		zero(in, j, SUMMARY(in, j) & ~m);
+		r = 0;
+		if (dense(in, j, m))
+			for (k = 0, e = span(in, j); k < e; ++k) {
+				i = 64 * j + k;
+				x = (out->a[i] & ~def->a[i]) | use->a[i];
+				changed |= x ^ in->a[i];
+				in->a[i] = x;
+				r |= (uint64_t)(x != 0) << k;
+			}
+		else for (w = m; w != 0; w &= w - 1) {
+			i = 64 * j + __builtin_ctzll(w);
+			x = (out->a[i] & ~def->a[i]) | use->a[i];
+			changed |= x ^ in->a[i];
+			in->a[i] = x;
+			if (x != 0)
+				r |= w & -w;
+		}
+		summarise(in, j, r);
+	}
+
+	return changed != 0;
+}
+
+/* propagate_relaxed: propagate() for an in which other threads read
+ * with or_relaxed and and_relaxed, so its words are stored with
+ * relaxed atomic stores. */
+bool propagate_relaxed(set_t* in, set_t* out, set_t* def, set_t* use)
+{
+	size_t		i;
+	size_t		j;
+	size_t		e;
+	size_t		k;
+	uint64_t	m;
+	uint64_t	w;
+	uint64_t	x;
+	uint64_t	r;
+	uint64_t	changed;
+
+	changed = 0;
+
+	for (j = 0; j < WORDS(in->n); ++j) {
+		m = SUMMARY(out, j) | SUMMARY(use, j);
+		changed |= SUMMARY(in, j) & ~m;
+		for (w = SUMMARY(in, j) & ~m; w != 0; w &= w - 1)
+			STORE(&in->a[64 * j + __builtin_ctzll(w)], 0);
+		r = m;
+		if (dense(in, j, m))
+			for (k = 0, e = span(in, j); k < e; ++k) {
+				i = 64 * j + k;
+				x = (out->a[i] & ~def->a[i]) | use->a[i];
+				changed |= x ^ in->a[i];
+				STORE(&in->a[i], x);
+				if (x == 0)
+					r &= ~(1ULL << k);
+			}
+		else for (w = m; w != 0; w &= w - 1) {
+			i = 64 * j + __builtin_ctzll(w);
+			x = (out->a[i] & ~def->a[i]) | use->a[i];
+			changed |= x ^ in->a[i];
+			STORE(&in->a[i], x);
+			if (x == 0)
+				r &= ~(w & -w);
+		}
+		STORE(&SUMMARY(in, j), r);
+	}
+
+	return changed != 0;
+}
+
+/* or_relaxed and and_relaxed: t |= a and t &= a, where a is read with
+ * relaxed atomic loads since another thread may be writing it. the
+ * words and summary of a may then disagree, so the summary of t is
+ * made from the words it gets, and and_relaxed only trusts its own. */
+void or_relaxed(set_t* t, set_t* a)
+{
+	size_t		i;
+	size_t		j;
+	size_t		k;
+	size_t		e;
+	uint64_t	m;
+	uint64_t	w;
+	uint64_t	x;
+	uint64_t	r;
+
+	for (j = 0; j < WORDS(t->n); ++j) {
+		m = SUMMARY(t, j) | LOAD(&SUMMARY(a, j));
+		r = m;
+		if (dense(t, j, m))
+			for (k = 0, e = span(t, j); k < e; ++k) {
+				i = 64 * j + k;
+				x = t->a[i] | LOAD(&a->a[i]);
+				t->a[i] = x;
+				if (x == 0)
+					r &= ~(1ULL << k);
+			}
+		else for (w = m; w != 0; w &= w - 1) {
+			i = 64 * j + __builtin_ctzll(w);
+			x = t->a[i] | LOAD(&a->a[i]);
+			t->a[i] = x;
+			if (x == 0)
+				r &= ~(w & -w);
+		}
+		summarise(t, j, r);
+	}
+}
+
+void and_relaxed(set_t* t, set_t* a)
+{
+	size_t		i;
+	size_t		j;
+	uint64_t	w;
+	uint64_t	x;
+	uint64_t	r;
+
+	for (j = 0; j < WORDS(t->n); ++j) {
+		r = 0;
+		for (w = SUMMARY(t, j); w != 0; w &= w - 1) {
+			i = 64 * j + __builtin_ctzll(w);
+			x = t->a[i] & LOAD(&a->a[i]);
+			t->a[i] = x;
+			if (x != 0)
+				r |= w & -w;
+		}
+		summarise(t, j, r);
+	}
+}
+
+/* grow: t->a[i] |= x with fetch_or, for a t which only grows. a word
+ * which already has the bits is not written, and the one thread which
+ * finds the word zero sets its summary bit. returns true if the word
+ * gained bits. */
+static bool grow(set_t* t, size_t i, uint64_t x)
+{
+	uint64_t	old;
+
+	if ((x & ~atomic_load_explicit(ATOMIC(&t->a[i]), memory_order_relaxed)) == 0)
+		return false;
+
+	old = atomic_fetch_or(ATOMIC(&t->a[i]), x);
+	if (old == 0)
+		atomic_fetch_or(ATOMIC(&SUMMARY(t, i / 64)), 1ULL << (i % 64));
+
+	return (x & ~old) != 0;
+}
+
+/* or_atomic: t |= a, where other threads may merge into both at the
+ * same time and neither ever loses bits. returns true if t grew. */
+bool or_atomic(set_t* t, set_t* a)
+{
+	size_t		i;
+	size_t		j;
+	uint64_t	m;
+	bool		changed;
+
+	changed = false;
+
+	for (j = 0; j < WORDS(t->n); ++j)
+		for (m = atomic_load(ATOMIC(&SUMMARY(a, j))); m != 0; m &= m - 1) {
+			i = 64 * j + __builtin_ctzll(m);
+			changed |= grow(t, i, atomic_load(ATOMIC(&a->a[i])));
+		}
+
+	return changed;
+}
+
+/* propagate_atomic: in |= use | (out - def) like or_atomic, which is
+ * propagate() when in and out only grow. */
+bool propagate_atomic(set_t* in, set_t* out, set_t* def, set_t* use)
+{
+	size_t		i;
+	size_t		j;
+	uint64_t	m;
+	bool		changed;
+
+	changed = false;
+
+	for (j = 0; j < WORDS(in->n); ++j) {
+		m = atomic_load(ATOMIC(&SUMMARY(out, j))) | SUMMARY(use, j);
+		for (; m != 0; m &= m - 1) {
+			i = 64 * j + __builtin_ctzll(m);
+			changed |= grow(in, i, (atomic_load(ATOMIC(&out->a[i])) & ~def->a[i]) | use->a[i]);
+		}
+	}
+
+	return changed;
+}
+
+/* stale: true if propagate would change in. */
+bool stale(set_t* in, set_t* out, set_t* def, set_t* use)
+{
+	size_t		i;
+	size_t		j;
+	size_t		e;
+	uint64_t	m;
+	uint64_t	w;
+
+	for (j = 0; j < WORDS(in->n); ++j) {
+		m = SUMMARY(out, j) | SUMMARY(use, j);
+		if (SUMMARY(in, j) & ~m)
+			return true;
+		if (dense(in, j, m)) {
+			for (i = 64 * j, e = i + span(in, j); i < e; ++i)
+				if (((out->a[i] & ~def->a[i]) | use->a[i]) != in->a[i])
+					return true;
+		} else for (w = m; w != 0; w &= w - 1) {
+			i = 64 * j + __builtin_ctzll(w);
+			if (((out->a[i] & ~def->a[i]) | use->a[i]) != in->a[i])
+				return true;
+		}
+	}
+
+	return false;
+}
+
+/* accumulate: out |= d, then keep in d only the bits this adds to in.
+ * only the words of d and use can add anything. */
+bool accumulate(set_t* in, set_t* out, set_t* def, set_t* use, set_t* d)
+{
+	size_t		i;
+	size_t		j;
+	size_t		e;
+	size_t		k;
+	uint64_t	m;
+	uint64_t	w;
+	uint64_t	x;
+	uint64_t	r;
+	uint64_t	changed;
+
+	changed = 0;
+
+	for (j = 0; j < WORDS(in->n); ++j) {
+		m = SUMMARY(d, j) | SUMMARY(use, j);
+		SUMMARY(out, j) |= SUMMARY(d, j);
+		r = 0;
+		if (dense(in, j, m))
+			for (k = 0, e = span(in, j); k < e; ++k) {
+				i = 64 * j + k;
+				out->a[i] |= d->a[i];
+				x = ((d->a[i] & ~def->a[i]) | use->a[i]) & ~in->a[i];
+				in->a[i] |= x;
+				d->a[i] = x;
+				r |= (uint64_t)(x != 0) << k;
+			}
+		else for (w = m; w != 0; w &= w - 1) {
+			i = 64 * j + __builtin_ctzll(w);
+			out->a[i] |= d->a[i];
+			x = ((d->a[i] & ~def->a[i]) | use->a[i]) & ~in->a[i];
+			in->a[i] |= x;
+			d->a[i] = x;
+			if (x != 0)
+				r |= w & -w;
+		}
+		SUMMARY(in, j) |= r;
+		summarise(d, j, r);
+		changed |= r;
+	}
+
+	return changed != 0;
+}
+
+size_t count(set_t* s)
+{
+	size_t		i;
+	size_t		j;
+	size_t		n;
+	uint64_t	m;
+
+	n = 0;
+	for (j = 0; j < WORDS(s->n); ++j)
+		for (m = SUMMARY(s, j); m != 0; m &= m - 1) {
+			i = 64 * j + __builtin_ctzll(m);
+			n += __builtin_popcountll(s->a[i]);
+		}
+
+	return n;
+}
+
+/* utoa: write x in decimal at p and return the end. */
+char* utoa(char* p, uint64_t x)
+{
+	char		tmp[20];
+	size_t		n;
+
+	n = 0;
+	do {
+		tmp[n++] = '0' + x % 10;
+		x /= 10;
+	} while (x != 0);
+
+	while (n > 0)
+		*p++ = tmp[--n];
+
+	return p;
+}
+
+/* format_set: what print_set prints, written at p. p needs room for
+ * 4 characters and a number and a space per element. */
+char* format_set(set_t* s, char* p)
+{
+	size_t		i;
+	size_t		j;
+	uint64_t	m;
+	uint64_t	w;
+
+	*p++ = '{';
+	*p++ = ' ';
+
+	for (j = 0; j < WORDS(s->n); ++j)
+		for (m = SUMMARY(s, j); m != 0; m &= m - 1) {
+			i = 64 * j + __builtin_ctzll(m);
+			for (w = s->a[i]; w != 0; w &= w - 1) {
+				p = utoa(p, 64 * i + __builtin_ctzll(w));
+				*p++ = ' ';
+			}
+		}
+
+	*p++ = '}';
+	*p++ = '\n';
 
-	for (i = 0; i < in->n; ++i)
-		in->a[i] = (out->a[i] & ~def->a[i]) | use->a[i];
+	return p;
 }
 
 bool test(set_t* s, uint64_t a)
@@ -7,19 +7,53 @@
 
 typedef struct set_t		set_t;
 
+/* set_t: n words of bits, followed by a summary with one bit per word
+ * which is set exactly when the word is not zero. the kernels only
+ * visit the words the summaries say may matter. */
+
 struct set_t {
 	size_t		n;	/* elements in array. */
 	uint64_t	a[];	/* C99 flexible array member. */
 };
 
+/* a slice is the SLICE elements under one summary word. the _slice
+ * kernels only touch summary words j0 up to j1 and their words, so
+ * threads working on different slices never write the same word, nor
+ * the same cache line when the words of the set start on a line. */
+#define SLICE		4096
+
 set_t*	new_set(size_t);
 void	free_set(set_t*);
+size_t	set_size(size_t);
+set_t*	place_set(void*, size_t);
+bool	valid_set(set_t*, size_t);
 void	set(set_t*, uint64_t);
+void	clear(set_t*, uint64_t);
 void	print_set(set_t *set, FILE *fp);
+char*	format_set(set_t*, char*);
+char*	utoa(char*, uint64_t);
+size_t	count(set_t*);
+uint64_t	hash_set(set_t*, uint64_t);
 bool	equal(set_t*, set_t*);
 bool	test(set_t*, uint64_t);
 void	or(set_t*, set_t*, set_t*);
-void	propagate(set_t*, set_t*, set_t*, set_t*);
+void	and(set_t*, set_t*, set_t*);
+void	minus(set_t*, set_t*, set_t*);
+bool	overlap(set_t*, set_t*);
+bool	propagate(set_t*, set_t*, set_t*, set_t*);
+bool	stale(set_t*, set_t*, set_t*, set_t*);
+bool	accumulate(set_t*, set_t*, set_t*, set_t*, set_t*);
+bool	propagate_relaxed(set_t*, set_t*, set_t*, set_t*);
+void	or_relaxed(set_t*, set_t*);
+void	and_relaxed(set_t*, set_t*);
+bool	or_atomic(set_t*, set_t*);
+bool	propagate_atomic(set_t*, set_t*, set_t*, set_t*);
 void	reset(set_t*);
+void	fill(set_t*, size_t);
+void	or_slice(set_t*, set_t*, set_t*, size_t, size_t);
+void	and_slice(set_t*, set_t*, set_t*, size_t, size_t);
+bool	propagate_slice(set_t*, set_t*, set_t*, set_t*, size_t, size_t);
+void	reset_slice(set_t*, size_t, size_t);
+void	fill_slice(set_t*, size_t, size_t, size_t);
 
 #endif
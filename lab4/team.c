@@ -0,0 +1,105 @@
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "team.h"
+#include "error.h"
+
+/* seat_t: what one thread of the team is given. */
+typedef struct {
+	team_t*		team;
+	void*		arg;
+} seat_t;
+
+struct team_t {
+	size_t		nthread;
+	pthread_t*	thread;
+	seat_t*		seat;
+	void*		(*func)(void*);
+	pthread_mutex_t	lock;		/* held by the thread in run.	*/
+	_Atomic unsigned generation;	/* incremented by each run.	*/
+	_Atomic unsigned running;	/* threads still in func.	*/
+};
+
+static void wait_while(_Atomic unsigned* word, unsigned value)
+{
+	while (atomic_load(word) == value)
+		syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static void wake_all(_Atomic unsigned* word)
+{
+	syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+static void* member(void* arg)
+{
+	seat_t*		seat = arg;
+	team_t*		team = seat->team;
+	unsigned	generation;
+
+	generation = 0;
+
+	for (;;) {
+		wait_while(&team->generation, generation);
+		generation = atomic_load(&team->generation);
+
+		(*team->func)(seat->arg);
+
+		if (atomic_fetch_sub(&team->running, 1) == 1)
+			wake_all(&team->running);
+	}
+
+	return NULL;
+}
+
+team_t* new_team(size_t nthread)
+{
+	team_t*		team;
+	size_t		i;
+	int		err;
+
+	team = calloc(1, sizeof(team_t));
+	if (team == NULL)
+		error("out of memory");
+
+	team->nthread = nthread;
+	pthread_mutex_init(&team->lock, NULL);
+	team->thread = calloc(nthread, sizeof team->thread[0]);
+	team->seat = calloc(nthread, sizeof team->seat[0]);
+	if (team->thread == NULL || team->seat == NULL)
+		error("out of memory");
+
+	for (i = 0; i < nthread; ++i) {
+		team->seat[i].team = team;
+		err = pthread_create(&team->thread[i], NULL, member, &team->seat[i]);
+		if (err)
+			syserror(err, "cannot create thread");
+	}
+
+	return team;
+}
+
+void run(team_t* team, void* (*func)(void*), void* arg, size_t size)
+{
+	unsigned	running;
+	size_t		i;
+
+	pthread_mutex_lock(&team->lock);
+
+	team->func = func;
+	for (i = 0; i < team->nthread; ++i)
+		team->seat[i].arg = (char*)arg + i * size;
+
+	atomic_store(&team->running, team->nthread);
+	atomic_fetch_add(&team->generation, 1);
+	wake_all(&team->generation);
+
+	while ((running = atomic_load(&team->running)) != 0)
+		wait_while(&team->running, running);
+
+	pthread_mutex_unlock(&team->lock);
+}
@@ -0,0 +1,19 @@
+#ifndef team_h
+#define team_h
+
+#include <stddef.h>
+
+typedef struct team_t	team_t;
+
+/* a team of threads which are started once and park on a futex while
+ * they have nothing to do. they are never stopped, so a team lasts
+ * until the process exits. */
+team_t*	new_team(size_t nthread);
+
+/* run: call func in every thread of the team, with the i-th element
+ * of the array arg of elements of size bytes in thread i, and return
+ * when all calls have returned. calls from different threads take
+ * turns, but func must not call run on its own team. */
+void	run(team_t*, void* (*func)(void*), void* arg, size_t size);
+
+#endif